@@ -1,293 +1,1171 @@
-/*
- * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
- *	The President and Fellows of Harvard College.
- *
- * Redistribution and use in source and binary forms, with or without
- * modification, are permitted provided that the following conditions
- * are met:
- * 1. Redistributions of source code must retain the above copyright
- *    notice, this list of conditions and the following disclaimer.
- * 2. Redistributions in binary form must reproduce the above copyright
- *    notice, this list of conditions and the following disclaimer in the
- *    documentation and/or other materials provided with the distribution.
- * 3. Neither the name of the University nor the names of its contributors
- *    may be used to endorse or promote products derived from this software
- *    without specific prior written permission.
- *
- * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
- * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
- * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
- * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
- * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
- * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
- * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
- * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
- * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
- * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
- * SUCH DAMAGE.
- */
-
-/*
- * Synchronization primitives.
- * The specifications of the functions are in synch.h.
- */
-
-#include <types.h>
-#include <lib.h>
-#include <spinlock.h>
-#include <wchan.h>
-#include <thread.h>
-#include <current.h>
-#include <synch.h>
-
-////////////////////////////////////////////////////////////
-//
-// Semaphore.
-
-struct semaphore *
-sem_create(const char *name, int initial_count)
-{
-        struct semaphore *sem;
-
-        KASSERT(initial_count >= 0);
-
-        sem = kmalloc(sizeof(struct semaphore));
-        if (sem == NULL) {
-                return NULL;
-        }
-
-        sem->sem_name = kstrdup(name);
-        if (sem->sem_name == NULL) {
-                kfree(sem);
-                return NULL;
-        }
-
-	sem->sem_wchan = wchan_create(sem->sem_name);
-	if (sem->sem_wchan == NULL) {
-		kfree(sem->sem_name);
-		kfree(sem);
-		return NULL;
-	}
-
-	spinlock_init(&sem->sem_lock);
-        sem->sem_count = initial_count;
-
-        return sem;
-}
-
-void
-sem_destroy(struct semaphore *sem)
-{
-        KASSERT(sem != NULL);
-
-	/* wchan_cleanup will assert if anyone's waiting on it */
-	spinlock_cleanup(&sem->sem_lock);
-	wchan_destroy(sem->sem_wchan);
-        kfree(sem->sem_name);
-        kfree(sem);
-}
-
-void 
-P(struct semaphore *sem)
-{
-        KASSERT(sem != NULL);
-
-        /*
-         * May not block in an interrupt handler.
-         *
-         * For robustness, always check, even if we can actually
-         * complete the P without blocking.
-         */
-        KASSERT(curthread->t_in_interrupt == false);
-
-	spinlock_acquire(&sem->sem_lock);
-        while (sem->sem_count == 0) {
-		/*
-		 * Bridge to the wchan lock, so if someone else comes
-		 * along in V right this instant the wakeup can't go
-		 * through on the wchan until we've finished going to
-		 * sleep. Note that wchan_sleep unlocks the wchan.
-		 *
-		 * Note that we don't maintain strict FIFO ordering of
-		 * threads going through the semaphore; that is, we
-		 * might "get" it on the first try even if other
-		 * threads are waiting. Apparently according to some
-		 * textbooks semaphores must for some reason have
-		 * strict ordering. Too bad. :-)
-		 *
-		 * Exercise: how would you implement strict FIFO
-		 * ordering?
-		 */
-		wchan_lock(sem->sem_wchan);
-		spinlock_release(&sem->sem_lock);
-                wchan_sleep(sem->sem_wchan);
-
-		spinlock_acquire(&sem->sem_lock);
-        }
-        KASSERT(sem->sem_count > 0);
-        sem->sem_count--;
-	spinlock_release(&sem->sem_lock);
-}
-
-void
-V(struct semaphore *sem)
-{
-        KASSERT(sem != NULL);
-
-	spinlock_acquire(&sem->sem_lock);
-
-        sem->sem_count++;
-        KASSERT(sem->sem_count > 0);
-	wchan_wakeone(sem->sem_wchan);
-
-	spinlock_release(&sem->sem_lock);
-}
-
-////////////////////////////////////////////////////////////
-//
-// Lock.
-
-struct lock *
-lock_create(const char *name)
-{
-        struct lock *lock;
-
-        lock = kmalloc(sizeof(struct lock));
-        if (lock == NULL) {
-                return NULL;
-        }
-
-        lock->lk_name = kstrdup(name);
-        if (lock->lk_name == NULL) {
-                kfree(lock);
-                return NULL;
-        }
-        
-        lock->lk_wchan = wchan_create(lock->lk_name);
-	if (lock->lk_wchan == NULL) {
-		kfree(lock->lk_name);
-		kfree(lock);
-		return NULL;
-	}
-
-	lock->locked = false;
-	lock->lk_holder = NULL;
-	spinlock_init(&lock->lk_spin);
-        
-        return lock;
-}
-
-void
-lock_destroy(struct lock *lock)
-{
-        KASSERT(lock != NULL);
-	wchan_destroy(lock->lk_wchan);
-	spinlock_cleanup(&lock->lk_spin);
-	kfree(lock->lk_holder);
-        kfree(lock->lk_name);
-        kfree(lock);
-}
-
-void
-lock_acquire(struct lock *lock)
-{
-	// Assert that thread trying to acquire does not already have lock
-	KASSERT(lock_do_i_hold(lock) == false);
-	spinlock_acquire(&lock->lk_spin);
-	while (lock->locked == true) {
-		wchan_lock(lock->lk_wchan);
-		spinlock_release(&lock->lk_spin);
-		wchan_sleep(lock->lk_wchan);
-		// Returns from sleep here
-		spinlock_acquire(&lock->lk_spin);
-	}
-	lock->lk_holder = curthread;
-	lock->locked = true;
-	spinlock_release(&lock->lk_spin);
-}
-
-void
-lock_release(struct lock *lock)
-{
-	// Only thread holding lock can release it
-	KASSERT(lock_do_i_hold(lock));
-	spinlock_acquire(&lock->lk_spin);
-	lock->lk_holder = NULL;
-	lock->locked = false;
-	// wchan_wakeone handles its own locking
-	wchan_wakeone(lock->lk_wchan);
-	spinlock_release(&lock->lk_spin);
-}
-
-bool
-lock_do_i_hold(struct lock *lock)
-{
-	return lock->lk_holder == curthread;
-}
-
-////////////////////////////////////////////////////////////
-//
-// CV
-
-
-struct cv *
-cv_create(const char *name)
-{
-        struct cv *cv;
-
-        cv = kmalloc(sizeof(struct cv));
-        if (cv == NULL) {
-                return NULL;
-        }
-
-        cv->cv_name = kstrdup(name);
-        if (cv->cv_name==NULL) {
-                kfree(cv);
-                return NULL;
-        }
-        
-	cv->cv_wchan = wchan_create(cv->cv_name);
-	if (cv->cv_wchan == NULL) {
-		kfree(cv->cv_name);
-		kfree(cv);
-		return NULL;
-	}
-        
-        return cv;
-}
-
-void
-cv_destroy(struct cv *cv)
-{
-        KASSERT(cv != NULL);
-        wchan_destroy(cv->cv_wchan);
-        kfree(cv->cv_name);
-        kfree(cv);
-}
-
-void
-cv_wait(struct cv *cv, struct lock *lock)
-{
-	// thread calling this is in the critical section
-	KASSERT(lock_do_i_hold(lock));
-	wchan_lock(cv->cv_wchan);
-	lock_release(lock);
-	wchan_sleep(cv->cv_wchan);
-	lock_acquire(lock);
-}
-
-void
-cv_signal(struct cv *cv, struct lock *lock)
-{
-	// thread calling this is in critical section
-	KASSERT(lock_do_i_hold(lock));
-	wchan_wakeone(cv->cv_wchan);
-}
-
-void
-cv_broadcast(struct cv *cv, struct lock *lock)
-{
-	// thread calling this is in critical section
-	KASSERT(lock_do_i_hold(lock));
-	wchan_wakeall(cv->cv_wchan);
-}
\ No newline at end of file
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Synchronization primitives.
+ * The specifications of the functions are in synch.h.
+ */
+
+#include <types.h>
+#include <lib.h>
+#include <spinlock.h>
+#include <wchan.h>
+#include <thread.h>
+#include <current.h>
+#include <cpu.h>
+#include <clock.h>
+#include <synch.h>
+
+/*
+ * Timed waits. A thread in P_timeout or cv_timedwait sleeps alone on
+ * a wchan of its own, described by a synch_timer on its stack, so it
+ * can be woken individually. Each timer is on two lists: the
+ * primitive's list of timed waiters (sem_timed, cv_timed), which V
+ * and cv_signal take waiters from, and synch_timers, every armed
+ * timer sorted by deadline, which synch_clock looks at on each
+ * hardclock tick. Whoever takes a timer off the lists wakes it;
+ * st_woken says whether that was V/cv_signal or the clock.
+ *
+ * synch_timeout_lock protects both lists and st_woken. It comes after
+ * the primitive's own lock and before any wchan lock. It is also held
+ * across the wakeup, and the woken thread takes it once before
+ * destroying its wchan, so the wchan cannot go away while the waker
+ * is still using it.
+ */
+struct synch_timer {
+	struct wchan *st_wchan;		/* the waiter sleeps here alone */
+	time_t st_secs;			/* deadline */
+	uint32_t st_nsecs;
+	bool st_woken;			/* woken by V/cv_signal, not the clock */
+	struct synch_timer **st_head;	/* the primitive's list */
+	struct synch_timer *st_next;	/* on *st_head, oldest first */
+	struct synch_timer *st_prev;
+	struct synch_timer *st_cnext;	/* on synch_timers, soonest first */
+	struct synch_timer *st_cprev;
+};
+
+static struct spinlock synch_timeout_lock = SPINLOCK_INITIALIZER;
+static struct synch_timer *synch_timers;
+
+static
+bool
+synch_timer_before(struct synch_timer *t, time_t secs, uint32_t nsecs)
+{
+	return t->st_secs < secs ||
+		(t->st_secs == secs && t->st_nsecs <= nsecs);
+}
+
+/*
+ * Get ready for a timed wait. Allocates the wchan, so is called
+ * before taking any spinlock; returns false if that fails.
+ */
+static
+bool
+synch_timer_init(struct synch_timer *t, const char *name,
+		 unsigned timeout_ms)
+{
+	t->st_wchan = wchan_create(name);
+	if (t->st_wchan == NULL) {
+		return false;
+	}
+	gettime(&t->st_secs, &t->st_nsecs);
+	t->st_secs += timeout_ms / 1000;
+	t->st_nsecs += (timeout_ms % 1000) * 1000000;
+	if (t->st_nsecs >= 1000000000) {
+		t->st_nsecs -= 1000000000;
+		t->st_secs++;
+	}
+	t->st_woken = false;
+	return true;
+}
+
+/*
+ * Put t on *head and on synch_timers, and lock its wchan ready for
+ * wchan_sleep. Called with the primitive's lock held, which the
+ * caller then releases before sleeping.
+ */
+static
+void
+synch_timer_arm(struct synch_timer *t, struct synch_timer **head)
+{
+	struct synch_timer **tp, *prev;
+
+	spinlock_acquire(&synch_timeout_lock);
+
+	prev = NULL;
+	for (tp = head; *tp != NULL; tp = &(*tp)->st_next) {
+		prev = *tp;
+	}
+	t->st_head = head;
+	t->st_prev = prev;
+	t->st_next = NULL;
+	*tp = t;
+
+	prev = NULL;
+	for (tp = &synch_timers; *tp != NULL &&
+		     synch_timer_before(*tp, t->st_secs, t->st_nsecs);
+	     tp = &(*tp)->st_cnext) {
+		prev = *tp;
+	}
+	t->st_cprev = prev;
+	t->st_cnext = *tp;
+	if (*tp != NULL) {
+		(*tp)->st_cprev = t;
+	}
+	*tp = t;
+
+	wchan_lock(t->st_wchan);
+	spinlock_release(&synch_timeout_lock);
+}
+
+/* Take t off both lists and wake it. Called with synch_timeout_lock. */
+static
+void
+synch_timer_fire(struct synch_timer *t)
+{
+	KASSERT(spinlock_do_i_hold(&synch_timeout_lock));
+
+	if (t->st_prev != NULL) {
+		t->st_prev->st_next = t->st_next;
+	}
+	else {
+		*t->st_head = t->st_next;
+	}
+	if (t->st_next != NULL) {
+		t->st_next->st_prev = t->st_prev;
+	}
+
+	if (t->st_cprev != NULL) {
+		t->st_cprev->st_cnext = t->st_cnext;
+	}
+	else {
+		synch_timers = t->st_cnext;
+	}
+	if (t->st_cnext != NULL) {
+		t->st_cnext->st_cprev = t->st_cprev;
+	}
+
+	wchan_wakeone(t->st_wchan);
+}
+
+/*
+ * Wake the oldest timed waiter on *head, if there is one, on behalf
+ * of V or cv_signal. Returns true if one was woken.
+ */
+static
+bool
+synch_timer_wakeone(struct synch_timer **head)
+{
+	struct synch_timer *t;
+
+	spinlock_acquire(&synch_timeout_lock);
+	t = *head;
+	if (t != NULL) {
+		t->st_woken = true;
+		synch_timer_fire(t);
+	}
+	spinlock_release(&synch_timeout_lock);
+	return t != NULL;
+}
+
+/* After waking: clean up, and say whether it was V/cv_signal. */
+static
+bool
+synch_timer_finish(struct synch_timer *t)
+{
+	bool woken;
+
+	spinlock_acquire(&synch_timeout_lock);
+	woken = t->st_woken;
+	spinlock_release(&synch_timeout_lock);
+	wchan_destroy(t->st_wchan);
+	return woken;
+}
+
+/*
+ * Called from the clock interrupt on every hardclock tick. Only the
+ * front of synch_timers can have expired, so a tick with nothing due
+ * costs one comparison. A timed wait therefore ends at most one tick
+ * (1/HZ) after its deadline, plus however long it then waits for a
+ * CPU.
+ */
+void
+synch_clock(void)
+{
+	time_t secs;
+	uint32_t nsecs;
+
+	if (synch_timers == NULL) {
+		/* unlocked look; anything armed now is not yet due */
+		return;
+	}
+	gettime(&secs, &nsecs);
+	spinlock_acquire(&synch_timeout_lock);
+	while (synch_timers != NULL &&
+	       synch_timer_before(synch_timers, secs, nsecs)) {
+		synch_timer_fire(synch_timers);
+	}
+	spinlock_release(&synch_timeout_lock);
+}
+
+////////////////////////////////////////////////////////////
+//
+// Semaphore.
+
+/*
+ * Semaphores created with sem_create_handoff are strictly FIFO: V
+ * gives its unit straight to the longest sleeper instead of adding it
+ * to the count for whoever gets there first. wchan_wakeone wakes
+ * sleepers in the order they went to sleep, and sem_waiters counts
+ * them, so a woken P already owns its unit and need not look again.
+ */
+struct semaphore *
+sem_create_handoff(const char *name, int initial_count)
+{
+	struct semaphore *sem;
+
+	sem = sem_create(name, initial_count);
+	if (sem != NULL) {
+		sem->sem_handoff = true;
+	}
+	return sem;
+}
+
+struct semaphore *
+sem_create(const char *name, int initial_count)
+{
+        struct semaphore *sem;
+
+        KASSERT(initial_count >= 0);
+
+        sem = kmalloc(sizeof(struct semaphore));
+        if (sem == NULL) {
+                return NULL;
+        }
+
+        sem->sem_name = kstrdup(name);
+        if (sem->sem_name == NULL) {
+                kfree(sem);
+                return NULL;
+        }
+
+	sem->sem_wchan = wchan_create(sem->sem_name);
+	if (sem->sem_wchan == NULL) {
+		kfree(sem->sem_name);
+		kfree(sem);
+		return NULL;
+	}
+
+	spinlock_init(&sem->sem_lock);
+        sem->sem_count = initial_count;
+	sem->sem_waiters = 0;
+	sem->sem_handoff = false;
+	sem->sem_timed = NULL;
+
+        return sem;
+}
+
+void
+sem_destroy(struct semaphore *sem)
+{
+        KASSERT(sem != NULL);
+
+	/* wchan_cleanup will assert if anyone's waiting on it */
+	KASSERT(sem->sem_timed == NULL);
+	spinlock_cleanup(&sem->sem_lock);
+	wchan_destroy(sem->sem_wchan);
+        kfree(sem->sem_name);
+        kfree(sem);
+}
+
+void 
+P(struct semaphore *sem)
+{
+        KASSERT(sem != NULL);
+
+        /*
+         * May not block in an interrupt handler.
+         *
+         * For robustness, always check, even if we can actually
+         * complete the P without blocking.
+         */
+        KASSERT(curthread->t_in_interrupt == false);
+
+	spinlock_acquire(&sem->sem_lock);
+	if (sem->sem_handoff && sem->sem_count == 0) {
+		/* V hands its unit to us and drops sem_waiters */
+		sem->sem_waiters++;
+		wchan_lock(sem->sem_wchan);
+		spinlock_release(&sem->sem_lock);
+		wchan_sleep(sem->sem_wchan);
+		return;
+	}
+        while (sem->sem_count == 0) {
+		/*
+		 * Bridge to the wchan lock, so if someone else comes
+		 * along in V right this instant the wakeup can't go
+		 * through on the wchan until we've finished going to
+		 * sleep. Note that wchan_sleep unlocks the wchan.
+		 *
+		 * Note that we don't maintain strict FIFO ordering of
+		 * threads going through the semaphore; that is, we
+		 * might "get" it on the first try even if other
+		 * threads are waiting. Apparently according to some
+		 * textbooks semaphores must for some reason have
+		 * strict ordering. Too bad. :-)
+		 *
+		 * Exercise: how would you implement strict FIFO
+		 * ordering?
+		 */
+		wchan_lock(sem->sem_wchan);
+		spinlock_release(&sem->sem_lock);
+                wchan_sleep(sem->sem_wchan);
+
+		spinlock_acquire(&sem->sem_lock);
+        }
+        KASSERT(sem->sem_count > 0);
+        sem->sem_count--;
+	spinlock_release(&sem->sem_lock);
+}
+
+void
+V(struct semaphore *sem)
+{
+        KASSERT(sem != NULL);
+
+	spinlock_acquire(&sem->sem_lock);
+
+	/*
+	 * A waiter in P_timeout gets the unit directly. Only the clock
+	 * takes timed waiters off sem_timed without sem_lock, so if we
+	 * see it empty it stays that way until we let go.
+	 */
+	if (sem->sem_timed != NULL && synch_timer_wakeone(&sem->sem_timed)) {
+		spinlock_release(&sem->sem_lock);
+		return;
+	}
+
+	if (sem->sem_handoff && sem->sem_waiters > 0) {
+		sem->sem_waiters--;
+		wchan_wakeone(sem->sem_wchan);
+		spinlock_release(&sem->sem_lock);
+		return;
+	}
+
+        sem->sem_count++;
+        KASSERT(sem->sem_count > 0);
+	wchan_wakeone(sem->sem_wchan);
+
+	spinlock_release(&sem->sem_lock);
+}
+
+bool
+sem_tryP(struct semaphore *sem)
+{
+	bool got = false;
+
+        KASSERT(sem != NULL);
+
+	spinlock_acquire(&sem->sem_lock);
+	if (sem->sem_count > 0) {
+		sem->sem_count--;
+		got = true;
+	}
+	spinlock_release(&sem->sem_lock);
+	return got;
+}
+
+bool
+P_timeout(struct semaphore *sem, unsigned timeout_ms)
+{
+	struct synch_timer t;
+
+        KASSERT(sem != NULL);
+        KASSERT(curthread->t_in_interrupt == false);
+
+	if (sem_tryP(sem)) {
+		return true;
+	}
+	if (timeout_ms == 0 || !synch_timer_init(&t, sem->sem_name,
+						 timeout_ms)) {
+		/* out of memory counts as timing out */
+		return false;
+	}
+
+	spinlock_acquire(&sem->sem_lock);
+	if (sem->sem_count > 0) {
+		sem->sem_count--;
+		spinlock_release(&sem->sem_lock);
+		wchan_destroy(t.st_wchan);
+		return true;
+	}
+	synch_timer_arm(&t, &sem->sem_timed);
+	spinlock_release(&sem->sem_lock);
+	wchan_sleep(t.st_wchan);
+
+	/* V handed us its unit, or the clock woke us empty-handed */
+	return synch_timer_finish(&t);
+}
+
+////////////////////////////////////////////////////////////
+//
+// Lock.
+
+/*
+ * Lock state lives in lk_word and is changed with the MIPS ll/sc
+ * atomics, so taking a free lock and releasing a lock nobody is
+ * waiting for are each a single atomic operation. lk_spin and
+ * lk_wchan are only touched once a thread has had to wait:
+ *
+ *    LOCK_FREE      - not held
+ *    LOCK_HELD      - held, nobody waiting
+ *    LOCK_CONTENDED - held, and someone may be asleep on lk_wchan,
+ *                     so lock_release must wake them
+ *
+ * A waiter sets LOCK_CONTENDED (under lk_spin) before sleeping, and
+ * keeps lk_spin until it holds the wchan lock, so the releaser, which
+ * takes lk_spin before waking anyone, cannot miss it. lk_waiters
+ * counts the sleepers; whoever wakes one takes it off the count.
+ *
+ * Locks created with lock_create_handoff never become free while
+ * anyone is asleep on them: lock_release passes ownership straight to
+ * the longest sleeper (wchan_wakeone is FIFO), so a newcomer cannot
+ * barge in ahead of it and a woken waiter never has to go back to
+ * sleep.
+ */
+#define LOCK_FREE	0
+#define LOCK_HELD	1
+#define LOCK_CONTENDED	2
+
+/* Atomically: if *p == old, set it to new. Returns the old *p. */
+static inline
+uint32_t
+lock_cas(volatile uint32_t *p, uint32_t old, uint32_t new)
+{
+	uint32_t prev, tmp;
+
+	__asm volatile(
+		".set push;"
+		".set mips32;"
+		".set noreorder;"
+		"1: ll %0, 0(%2);"
+		"bne %0, %3, 2f;"
+		"move %1, %4;"		/* delay slot */
+		"sc %1, 0(%2);"
+		"beqz %1, 1b;"
+		"nop;"
+		"2: .set pop"
+		: "=&r" (prev), "=&r" (tmp)
+		: "r" (p), "r" (old), "r" (new)
+		: "memory");
+	return prev;
+}
+
+/* Atomically set *p to new. Returns the old *p. */
+static inline
+uint32_t
+lock_xchg(volatile uint32_t *p, uint32_t new)
+{
+	uint32_t prev, tmp;
+
+	__asm volatile(
+		".set push;"
+		".set mips32;"
+		".set noreorder;"
+		"1: ll %0, 0(%2);"
+		"move %1, %3;"
+		"sc %1, 0(%2);"
+		"beqz %1, 1b;"
+		"nop;"
+		".set pop"
+		: "=&r" (prev), "=&r" (tmp)
+		: "r" (p), "r" (new)
+		: "memory");
+	return prev;
+}
+
+/*
+ * Adaptive locking: when the lock is taken by a thread that is
+ * currently running on another CPU, it is likely to be released
+ * soon, so spin for a while before going to sleep. This saves the two
+ * context switches of sleeping on short critical sections. If the
+ * holder is not running (or is on our CPU, which can't happen while
+ * we are running) there is no point spinning, so sleep at once.
+ *
+ * LOCK_SPIN_MAX bounds the spin so a long critical section costs at
+ * most that many iterations before falling back to sleeping.
+ */
+#define LOCK_SPIN_MAX 1000
+
+/*
+ * Is the holder of the lock running on another CPU? Called without
+ * lk_spin held, so lk_holder may change (or the thread it named may
+ * exit) under us; the answer only steers the spin, and thread
+ * structures are in direct-mapped kernel memory, so a stale read is
+ * harmless.
+ */
+static
+bool
+lock_holder_running(struct lock *lock)
+{
+	volatile struct thread *holder = lock->lk_holder;
+
+	return holder != NULL && holder->t_state == S_RUN &&
+		holder->t_cpu != curcpu;
+}
+
+struct lock *
+lock_create(const char *name)
+{
+        struct lock *lock;
+
+        lock = kmalloc(sizeof(struct lock));
+        if (lock == NULL) {
+                return NULL;
+        }
+
+        lock->lk_name = kstrdup(name);
+        if (lock->lk_name == NULL) {
+                kfree(lock);
+                return NULL;
+        }
+        
+        lock->lk_wchan = wchan_create(lock->lk_name);
+	if (lock->lk_wchan == NULL) {
+		kfree(lock->lk_name);
+		kfree(lock);
+		return NULL;
+	}
+
+	lock->lk_word = LOCK_FREE;
+	lock->lk_holder = NULL;
+	lock->lk_waiters = 0;
+	lock->lk_handoff = false;
+	lock->lk_morphhead = NULL;
+	spinlock_init(&lock->lk_spin);
+        
+        return lock;
+}
+
+struct lock *
+lock_create_handoff(const char *name)
+{
+	struct lock *lock;
+
+	lock = lock_create(name);
+	if (lock != NULL) {
+		lock->lk_handoff = true;
+	}
+	return lock;
+}
+
+void
+lock_destroy(struct lock *lock)
+{
+        KASSERT(lock != NULL);
+	KASSERT(lock->lk_morphhead == NULL);
+	wchan_destroy(lock->lk_wchan);
+	spinlock_cleanup(&lock->lk_spin);
+	kfree(lock->lk_holder);
+        kfree(lock->lk_name);
+        kfree(lock);
+}
+
+/*
+ * Slow path of lock_acquire: the lock was taken when we looked.
+ */
+static
+void
+lock_acquire_slow(struct lock *lock)
+{
+	bool spin = true;
+
+	spinlock_acquire(&lock->lk_spin);
+	/*
+	 * Mark the lock contended so its release will wake us. If it
+	 * turns out to have been free, we now hold it (marked contended,
+	 * which only costs its next release a trip through the slow
+	 * path).
+	 */
+	while (lock_xchg(&lock->lk_word, LOCK_CONTENDED) != LOCK_FREE) {
+		if (spin && lock_holder_running(lock)) {
+			int spins = 0;
+
+			spin = false;
+			spinlock_release(&lock->lk_spin);
+			while (lock->lk_word != LOCK_FREE &&
+			       spins < LOCK_SPIN_MAX &&
+			       lock_holder_running(lock)) {
+				spins++;
+			}
+			spinlock_acquire(&lock->lk_spin);
+			continue;
+		}
+		lock->lk_waiters++;
+		wchan_lock(lock->lk_wchan);
+		spinlock_release(&lock->lk_spin);
+		wchan_sleep(lock->lk_wchan);
+		// Returns from sleep here
+		spinlock_acquire(&lock->lk_spin);
+		if (lock->lk_handoff) {
+			// lock_release handed the lock to us
+			break;
+		}
+		spin = true;
+	}
+	lock->lk_holder = curthread;
+	spinlock_release(&lock->lk_spin);
+}
+
+void
+lock_acquire(struct lock *lock)
+{
+	// Assert that thread trying to acquire does not already have lock
+	KASSERT(lock_do_i_hold(lock) == false);
+	if (lock_cas(&lock->lk_word, LOCK_FREE, LOCK_HELD) == LOCK_FREE) {
+		lock->lk_holder = curthread;
+		return;
+	}
+	lock_acquire_slow(lock);
+}
+
+bool
+lock_tryacquire(struct lock *lock)
+{
+	KASSERT(lock_do_i_hold(lock) == false);
+	if (lock_cas(&lock->lk_word, LOCK_FREE, LOCK_HELD) == LOCK_FREE) {
+		lock->lk_holder = curthread;
+		return true;
+	}
+	return false;
+}
+
+/*
+ * Wait morphing. cv_signal and cv_broadcast don't wake anyone
+ * straight away: the waiters they pick are parked on the lock
+ * (lk_morphhead, a list of CVs with cv_pending wakeups each), and each
+ * lock_release wakes one of them just as the lock becomes available.
+ * Woken waiters then find the lock free instead of waking up only to
+ * sleep again on a lock the signaller still holds, and a broadcast
+ * lets its waiters in one release at a time rather than all at once.
+ * The list is only touched by the lock's holder, so the lock itself
+ * protects it.
+ */
+static
+void
+lock_wake_morphed(struct lock *lock)
+{
+	struct cv *cv = lock->lk_morphhead;
+
+	if (cv == NULL) {
+		return;
+	}
+	KASSERT(cv->cv_pending > 0);
+	cv->cv_pending--;
+	if (cv->cv_pending == 0) {
+		lock->lk_morphhead = cv->cv_morphnext;
+		cv->cv_morphnext = NULL;
+	}
+	wchan_wakeone(cv->cv_wchan);
+}
+
+/* lock_release without waking a morphed CV waiter */
+static
+void
+lock_release_nomorph(struct lock *lock)
+{
+	// Only thread holding lock can release it
+	KASSERT(lock_do_i_hold(lock));
+	lock->lk_holder = NULL;
+	if (lock_cas(&lock->lk_word, LOCK_HELD, LOCK_FREE) == LOCK_HELD) {
+		return;
+	}
+	// Someone may be asleep; lk_spin orders us after their
+	// wchan_lock, and wchan_wakeone handles its own locking
+	spinlock_acquire(&lock->lk_spin);
+	if (lock->lk_handoff && lock->lk_waiters > 0) {
+		// lk_word stays CONTENDED: the lock goes straight to
+		// the oldest waiter without ever being free
+		lock->lk_waiters--;
+		wchan_wakeone(lock->lk_wchan);
+	}
+	else {
+		lock->lk_word = LOCK_FREE;
+		if (lock->lk_waiters > 0) {
+			lock->lk_waiters--;
+			wchan_wakeone(lock->lk_wchan);
+		}
+	}
+	spinlock_release(&lock->lk_spin);
+}
+
+void
+lock_release(struct lock *lock)
+{
+	KASSERT(lock_do_i_hold(lock));
+	lock_wake_morphed(lock);
+	lock_release_nomorph(lock);
+}
+
+bool
+lock_do_i_hold(struct lock *lock)
+{
+	return lock->lk_holder == curthread;
+}
+
+////////////////////////////////////////////////////////////
+//
+// CV
+
+
+struct cv *
+cv_create(const char *name)
+{
+        struct cv *cv;
+
+        cv = kmalloc(sizeof(struct cv));
+        if (cv == NULL) {
+                return NULL;
+        }
+
+        cv->cv_name = kstrdup(name);
+        if (cv->cv_name==NULL) {
+                kfree(cv);
+                return NULL;
+        }
+        
+	cv->cv_wchan = wchan_create(cv->cv_name);
+	if (cv->cv_wchan == NULL) {
+		kfree(cv->cv_name);
+		kfree(cv);
+		return NULL;
+	}
+
+	cv->cv_waiters = 0;
+	cv->cv_pending = 0;
+	cv->cv_morphnext = NULL;
+	cv->cv_timed = NULL;
+        
+        return cv;
+}
+
+void
+cv_destroy(struct cv *cv)
+{
+        KASSERT(cv != NULL);
+	KASSERT(cv->cv_pending == 0);
+	KASSERT(cv->cv_timed == NULL);
+        wchan_destroy(cv->cv_wchan);
+        kfree(cv->cv_name);
+        kfree(cv);
+}
+
+/*
+ * Move n of cv's sleepers onto lock's list of morphed waiters (see
+ * lock_wake_morphed).
+ */
+static
+void
+cv_morph(struct cv *cv, struct lock *lock, unsigned n)
+{
+	struct cv **cvp;
+
+	if (n == 0) {
+		return;
+	}
+	cv->cv_waiters -= n;
+	if (cv->cv_pending == 0) {
+		/* append, so earlier signals are delivered first */
+		for (cvp = &lock->lk_morphhead; *cvp != NULL;
+		     cvp = &(*cvp)->cv_morphnext) {
+			/* nothing */
+		}
+		*cvp = cv;
+	}
+	cv->cv_pending += n;
+}
+
+void
+cv_wait(struct cv *cv, struct lock *lock)
+{
+	// thread calling this is in the critical section
+	KASSERT(lock_do_i_hold(lock));
+	// Wake a morphed waiter now, before taking cv's wchan lock, in
+	// case it is waiting on this same cv
+	lock_wake_morphed(lock);
+	cv->cv_waiters++;
+	wchan_lock(cv->cv_wchan);
+	lock_release_nomorph(lock);
+	wchan_sleep(cv->cv_wchan);
+	lock_acquire(lock);
+}
+
+void
+cv_signal(struct cv *cv, struct lock *lock)
+{
+	// thread calling this is in critical section
+	KASSERT(lock_do_i_hold(lock));
+	if (cv->cv_timed != NULL && synch_timer_wakeone(&cv->cv_timed)) {
+		return;
+	}
+	if (cv->cv_waiters > 0) {
+		cv_morph(cv, lock, 1);
+	}
+}
+
+void
+cv_broadcast(struct cv *cv, struct lock *lock)
+{
+	// thread calling this is in critical section
+	KASSERT(lock_do_i_hold(lock));
+	cv_morph(cv, lock, cv->cv_waiters);
+	while (cv->cv_timed != NULL && synch_timer_wakeone(&cv->cv_timed)) {
+		/* nothing */
+	}
+}
+
+/*
+ * Timed waiters sleep on their own wchans (see synch_timer) rather
+ * than cv_wchan, and are not morphed: cv_signal wakes one straight
+ * away, ahead of any cv_wait sleeper, since it is about to give up
+ * anyway, and cv_broadcast wakes them all.
+ */
+bool
+cv_timedwait(struct cv *cv, struct lock *lock, unsigned timeout_ms)
+{
+	struct synch_timer t;
+
+	KASSERT(lock_do_i_hold(lock));
+	KASSERT(curthread->t_in_interrupt == false);
+
+	if (timeout_ms == 0 || !synch_timer_init(&t, cv->cv_name,
+						 timeout_ms)) {
+		/* out of memory counts as timing out */
+		return false;
+	}
+	// as in cv_wait, wake a morphed waiter before locking our wchan
+	lock_wake_morphed(lock);
+	// cv_timed is protected by lock as well as synch_timeout_lock,
+	// so cv_signal's unlocked look at it is safe
+	synch_timer_arm(&t, &cv->cv_timed);
+	lock_release_nomorph(lock);
+	wchan_sleep(t.st_wchan);
+	lock_acquire(lock);
+	return synch_timer_finish(&t);
+}
+
+////////////////////////////////////////////////////////////
+//
+// Reader-writer lock.
+
+struct rwlock *
+rwlock_create(const char *name)
+{
+        struct rwlock *rw;
+
+        rw = kmalloc(sizeof(struct rwlock));
+        if (rw == NULL) {
+                return NULL;
+        }
+
+        rw->rw_name = kstrdup(name);
+        if (rw->rw_name == NULL) {
+                kfree(rw);
+                return NULL;
+        }
+
+	rw->rw_rwchan = wchan_create(rw->rw_name);
+	rw->rw_wwchan = wchan_create(rw->rw_name);
+	rw->rw_uwchan = wchan_create(rw->rw_name);
+	if (rw->rw_rwchan == NULL || rw->rw_wwchan == NULL ||
+	    rw->rw_uwchan == NULL) {
+		if (rw->rw_rwchan != NULL) {
+			wchan_destroy(rw->rw_rwchan);
+		}
+		if (rw->rw_wwchan != NULL) {
+			wchan_destroy(rw->rw_wwchan);
+		}
+		if (rw->rw_uwchan != NULL) {
+			wchan_destroy(rw->rw_uwchan);
+		}
+		kfree(rw->rw_name);
+		kfree(rw);
+		return NULL;
+	}
+
+	spinlock_init(&rw->rw_spin);
+	rw->rw_readers = 0;
+	rw->rw_rwaiting = 0;
+	rw->rw_wwaiting = 0;
+	rw->rw_writer = NULL;
+	rw->rw_upgrading = false;
+
+        return rw;
+}
+
+void
+rwlock_destroy(struct rwlock *rw)
+{
+        KASSERT(rw != NULL);
+	KASSERT(rw->rw_readers == 0);
+	KASSERT(rw->rw_writer == NULL);
+
+	spinlock_cleanup(&rw->rw_spin);
+	wchan_destroy(rw->rw_rwchan);
+	wchan_destroy(rw->rw_wwchan);
+	wchan_destroy(rw->rw_uwchan);
+        kfree(rw->rw_name);
+        kfree(rw);
+}
+
+/*
+ * Sleep on wc. Called and returns with rw_spin held; as in P, the
+ * wchan lock bridges the gap so a wakeup cannot slip in between.
+ */
+static
+void
+rwlock_sleep(struct rwlock *rw, struct wchan *wc)
+{
+	wchan_lock(wc);
+	spinlock_release(&rw->rw_spin);
+	wchan_sleep(wc);
+	spinlock_acquire(&rw->rw_spin);
+}
+
+/*
+ * The lock has just become free of writers, and of readers unless
+ * downgrading. A waiting writer goes first; otherwise every waiting
+ * reader is let in. Called with rw_spin held.
+ */
+static
+void
+rwlock_wakeup(struct rwlock *rw)
+{
+	if (rw->rw_readers == 0 && rw->rw_wwaiting > 0) {
+		wchan_wakeone(rw->rw_wwchan);
+	}
+	else if (rw->rw_wwaiting == 0 && rw->rw_rwaiting > 0) {
+		wchan_wakeall(rw->rw_rwchan);
+	}
+}
+
+void
+rwlock_acquire_read(struct rwlock *rw)
+{
+	KASSERT(rw != NULL);
+	KASSERT(curthread->t_in_interrupt == false);
+
+	spinlock_acquire(&rw->rw_spin);
+	KASSERT(rw->rw_writer != curthread);
+	while (rw->rw_writer != NULL || rw->rw_wwaiting > 0 ||
+	       rw->rw_upgrading) {
+		rw->rw_rwaiting++;
+		rwlock_sleep(rw, rw->rw_rwchan);
+		rw->rw_rwaiting--;
+	}
+	rw->rw_readers++;
+	spinlock_release(&rw->rw_spin);
+}
+
+/* Drop a read hold. Called with rw_spin held. */
+static
+void
+rwlock_drop_read(struct rwlock *rw)
+{
+	KASSERT(rw->rw_readers > 0);
+	rw->rw_readers--;
+	if (rw->rw_upgrading) {
+		// the upgrader still holds its own read hold
+		if (rw->rw_readers == 1) {
+			wchan_wakeone(rw->rw_uwchan);
+		}
+	}
+	else if (rw->rw_readers == 0) {
+		rwlock_wakeup(rw);
+	}
+}
+
+void
+rwlock_release_read(struct rwlock *rw)
+{
+	KASSERT(rw != NULL);
+
+	spinlock_acquire(&rw->rw_spin);
+	rwlock_drop_read(rw);
+	spinlock_release(&rw->rw_spin);
+}
+
+void
+rwlock_acquire_write(struct rwlock *rw)
+{
+	KASSERT(rw != NULL);
+	KASSERT(curthread->t_in_interrupt == false);
+
+	spinlock_acquire(&rw->rw_spin);
+	KASSERT(rw->rw_writer != curthread);
+	while (rw->rw_writer != NULL || rw->rw_readers > 0 ||
+	       rw->rw_upgrading) {
+		rw->rw_wwaiting++;
+		rwlock_sleep(rw, rw->rw_wwchan);
+		rw->rw_wwaiting--;
+	}
+	rw->rw_writer = curthread;
+	spinlock_release(&rw->rw_spin);
+}
+
+void
+rwlock_release_write(struct rwlock *rw)
+{
+	KASSERT(rw != NULL);
+
+	spinlock_acquire(&rw->rw_spin);
+	KASSERT(rw->rw_writer == curthread);
+	rw->rw_writer = NULL;
+	rwlock_wakeup(rw);
+	spinlock_release(&rw->rw_spin);
+}
+
+/*
+ * While a reader is upgrading, new readers and writers wait, so the
+ * upgrade only has to outlast the readers already inside. Two readers
+ * upgrading at once would each wait for the other, which is why the
+ * second one gives up its hold instead.
+ */
+bool
+rwlock_upgrade(struct rwlock *rw)
+{
+	KASSERT(rw != NULL);
+	KASSERT(curthread->t_in_interrupt == false);
+
+	spinlock_acquire(&rw->rw_spin);
+	KASSERT(rw->rw_readers > 0);
+	if (rw->rw_upgrading) {
+		rwlock_drop_read(rw);
+		spinlock_release(&rw->rw_spin);
+		return false;
+	}
+	rw->rw_upgrading = true;
+	while (rw->rw_readers > 1) {
+		rwlock_sleep(rw, rw->rw_uwchan);
+	}
+	rw->rw_upgrading = false;
+	rw->rw_readers = 0;
+	rw->rw_writer = curthread;
+	spinlock_release(&rw->rw_spin);
+	return true;
+}
+
+void
+rwlock_downgrade(struct rwlock *rw)
+{
+	KASSERT(rw != NULL);
+
+	spinlock_acquire(&rw->rw_spin);
+	KASSERT(rw->rw_writer == curthread);
+	rw->rw_writer = NULL;
+	rw->rw_readers = 1;
+	rwlock_wakeup(rw);
+	spinlock_release(&rw->rw_spin);
+}
+
+bool
+rwlock_do_i_write(struct rwlock *rw)
+{
+	return rw->rw_writer == curthread;
+}
+
+////////////////////////////////////////////////////////////
+//
+// Sequence lock.
+
+/*
+ * Order the loads or stores on either side of it; the data and
+ * sl_seq must be seen to change in the right order by other CPUs.
+ */
+static inline
+void
+seqlock_membar(void)
+{
+	__asm volatile(
+		".set push;"
+		".set mips32;"
+		"sync;"
+		".set pop"
+		::: "memory");
+}
+
+void
+seqlock_init(struct seqlock *sl)
+{
+	spinlock_init(&sl->sl_lock);
+	sl->sl_seq = 0;
+}
+
+void
+seqlock_cleanup(struct seqlock *sl)
+{
+	KASSERT((sl->sl_seq & 1) == 0);
+	spinlock_cleanup(&sl->sl_lock);
+}
+
+unsigned
+seqlock_read_begin(const struct seqlock *sl)
+{
+	unsigned seq;
+
+	while ((seq = sl->sl_seq) & 1) {
+		/* a writer is in the middle of it; wait it out */
+	}
+	seqlock_membar();
+	return seq;
+}
+
+bool
+seqlock_read_retry(const struct seqlock *sl, unsigned seq)
+{
+	seqlock_membar();
+	return sl->sl_seq != seq;
+}
+
+void
+seqlock_write_begin(struct seqlock *sl)
+{
+	spinlock_acquire(&sl->sl_lock);
+	sl->sl_seq++;
+	seqlock_membar();
+}
+
+void
+seqlock_write_end(struct seqlock *sl)
+{
+	KASSERT(sl->sl_seq & 1);
+	seqlock_membar();
+	sl->sl_seq++;
+	spinlock_release(&sl->sl_lock);
+}
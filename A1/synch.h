@@ -1,142 +1,306 @@
-/*
- * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
- *	The President and Fellows of Harvard College.
- *
- * Redistribution and use in source and binary forms, with or without
- * modification, are permitted provided that the following conditions
- * are met:
- * 1. Redistributions of source code must retain the above copyright
- *    notice, this list of conditions and the following disclaimer.
- * 2. Redistributions in binary form must reproduce the above copyright
- *    notice, this list of conditions and the following disclaimer in the
- *    documentation and/or other materials provided with the distribution.
- * 3. Neither the name of the University nor the names of its contributors
- *    may be used to endorse or promote products derived from this software
- *    without specific prior written permission.
- *
- * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
- * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
- * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
- * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
- * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
- * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
- * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
- * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
- * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
- * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
- * SUCH DAMAGE.
- */
-
-#ifndef _SYNCH_H_
-#define _SYNCH_H_
-
-/*
- * Header file for synchronization primitives.
- */
-
-
-#include <spinlock.h>
-
-/*
- * Dijkstra-style semaphore.
- *
- * The name field is for easier debugging. A copy of the name is made
- * internally.
- */
-struct semaphore {
-        char *sem_name;
-	struct wchan *sem_wchan;
-	struct spinlock sem_lock;
-        volatile int sem_count;
-};
-
-struct semaphore *sem_create(const char *name, int initial_count);
-void sem_destroy(struct semaphore *);
-
-/*
- * Operations (both atomic):
- *     P (proberen): decrement count. If the count is 0, block until
- *                   the count is 1 again before decrementing.
- *     V (verhogen): increment count.
- */
-void P(struct semaphore *);
-void V(struct semaphore *);
-
-
-/*
- * Simple lock for mutual exclusion.
- *
- * When the lock is created, no thread should be holding it. Likewise,
- * when the lock is destroyed, no thread should be holding it.
- *
- * The name field is for easier debugging. A copy of the name is
- * (should be) made internally.
- */
-struct lock {
-        char *lk_name;
-	struct thread *lk_holder;
-	struct wchan *lk_wchan;
-	struct spinlock lk_spin;
-	bool locked;
-};
-
-struct lock *lock_create(const char *name);
-void lock_acquire(struct lock *);
-
-/*
- * Operations:
- *    lock_acquire - Get the lock. Only one thread can hold the lock at the
- *                   same time.
- *    lock_release - Free the lock. Only the thread holding the lock may do
- *                   this.
- *    lock_do_i_hold - Return true if the current thread holds the lock; 
- *                   false otherwise.
- *
- * These operations must be atomic. You get to write them.
- */
-void lock_release(struct lock *);
-bool lock_do_i_hold(struct lock *);
-void lock_destroy(struct lock *);
-
-
-/*
- * Condition variable.
- *
- * Note that the "variable" is a bit of a misnomer: a CV is normally used
- * to wait until a variable meets a particular condition, but there's no
- * actual variable, as such, in the CV.
- *
- * These CVs are expected to support Mesa semantics, that is, no
- * guarantees are made about scheduling.
- *
- * The name field is for easier debugging. A copy of the name is
- * (should be) made internally.
- */
-
-struct cv {
-        char *cv_name;
-	struct wchan *cv_wchan;
-};
-
-struct cv *cv_create(const char *name);
-void cv_destroy(struct cv *);
-
-/*
- * Operations:
- *    cv_wait      - Release the supplied lock, go to sleep, and, after
- *                   waking up again, re-acquire the lock.
- *    cv_signal    - Wake up one thread that's sleeping on this CV.
- *    cv_broadcast - Wake up all threads sleeping on this CV.
- *
- * For all three operations, the current thread must hold the lock passed 
- * in. Note that under normal circumstances the same lock should be used
- * on all operations with any particular CV.
- *
- * These operations must be atomic. You get to write them.
- */
-void cv_wait(struct cv *cv, struct lock *lock);
-void cv_signal(struct cv *cv, struct lock *lock);
-void cv_broadcast(struct cv *cv, struct lock *lock);
-
-
-#endif /* _SYNCH_H_ */
\ No newline at end of file
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _SYNCH_H_
+#define _SYNCH_H_
+
+/*
+ * Header file for synchronization primitives.
+ */
+
+
+#include <spinlock.h>
+
+struct synch_timer;		/* a timed waiter; private to synch.c */
+
+/*
+ * Dijkstra-style semaphore.
+ *
+ * The name field is for easier debugging. A copy of the name is made
+ * internally.
+ */
+struct semaphore {
+        char *sem_name;
+	struct wchan *sem_wchan;
+	struct spinlock sem_lock;
+        volatile int sem_count;
+	unsigned sem_waiters;		/* sleepers, for handoff mode */
+	bool sem_handoff;		/* V hands units to sleepers FIFO */
+	struct synch_timer *sem_timed;	/* sleepers in P_timeout */
+};
+
+struct semaphore *sem_create(const char *name, int initial_count);
+struct semaphore *sem_create_handoff(const char *name, int initial_count);
+void sem_destroy(struct semaphore *);
+
+/*
+ * Operations (both atomic):
+ *     P (proberen): decrement count. If the count is 0, block until
+ *                   the count is 1 again before decrementing.
+ *     V (verhogen): increment count.
+ *
+ * A semaphore made with sem_create_handoff is strictly FIFO: V gives
+ * its unit directly to the thread that has waited longest in P.
+ */
+void P(struct semaphore *);
+void V(struct semaphore *);
+
+/*
+ * Non-blocking and bounded variants of P:
+ *     sem_tryP:  decrement count if it is above 0; never blocks.
+ *     P_timeout: like P, but give up after timeout_ms milliseconds.
+ * Both return true if the count was decremented. P_timeout sleeps, and
+ * is woken by V or by the clock; it returns false no earlier than
+ * timeout_ms and at most about one clock tick later. V serves threads
+ * in P_timeout before those in P.
+ */
+bool sem_tryP(struct semaphore *);
+bool P_timeout(struct semaphore *, unsigned timeout_ms);
+
+
+/*
+ * Simple lock for mutual exclusion.
+ *
+ * When the lock is created, no thread should be holding it. Likewise,
+ * when the lock is destroyed, no thread should be holding it.
+ *
+ * The name field is for easier debugging. A copy of the name is
+ * (should be) made internally.
+ *
+ * Taking a free lock and releasing an uncontended one are a single
+ * atomic operation on lk_word. lock_acquire spins briefly instead of
+ * sleeping while the holder is running on another CPU. A lock made
+ * with lock_create_handoff is strictly FIFO: lock_release passes it
+ * directly to the longest waiter (see synch.c).
+ *
+ * There is no priority inheritance. The scheduler runs all threads
+ * round-robin with no priorities, so a waiter has nothing to lend the
+ * holder; use a handoff lock where a waiter's delay must be bounded.
+ */
+struct lock {
+        char *lk_name;
+	struct thread *volatile lk_holder;
+	struct wchan *lk_wchan;
+	struct spinlock lk_spin;
+	volatile uint32_t lk_word;	/* LOCK_FREE/HELD/CONTENDED */
+	unsigned lk_waiters;		/* sleepers on lk_wchan */
+	bool lk_handoff;		/* release hands off FIFO */
+	struct cv *lk_morphhead;	/* CVs with waiters to wake on release */
+};
+
+struct lock *lock_create(const char *name);
+struct lock *lock_create_handoff(const char *name);
+void lock_acquire(struct lock *);
+
+/*
+ * Operations:
+ *    lock_acquire - Get the lock. Only one thread can hold the lock at the
+ *                   same time.
+ *    lock_release - Free the lock. Only the thread holding the lock may do
+ *                   this.
+ *    lock_do_i_hold - Return true if the current thread holds the lock; 
+ *                   false otherwise.
+ *    lock_tryacquire - Get the lock if it is free and return true;
+ *                   otherwise return false at once.
+ *
+ * These operations must be atomic. You get to write them.
+ */
+void lock_release(struct lock *);
+bool lock_do_i_hold(struct lock *);
+bool lock_tryacquire(struct lock *);
+void lock_destroy(struct lock *);
+
+
+/*
+ * Condition variable.
+ *
+ * Note that the "variable" is a bit of a misnomer: a CV is normally used
+ * to wait until a variable meets a particular condition, but there's no
+ * actual variable, as such, in the CV.
+ *
+ * These CVs are expected to support Mesa semantics, that is, no
+ * guarantees are made about scheduling.
+ *
+ * The name field is for easier debugging. A copy of the name is
+ * (should be) made internally.
+ */
+
+struct cv {
+        char *cv_name;
+	struct wchan *cv_wchan;
+	unsigned cv_waiters;		/* asleep and not yet signalled */
+	unsigned cv_pending;		/* signalled, to be woken on release */
+	struct cv *cv_morphnext;	/* next on the lock's lk_morphhead */
+	struct synch_timer *cv_timed;	/* sleepers in cv_timedwait */
+};
+
+struct cv *cv_create(const char *name);
+void cv_destroy(struct cv *);
+
+/*
+ * Operations:
+ *    cv_wait      - Release the supplied lock, go to sleep, and, after
+ *                   waking up again, re-acquire the lock.
+ *    cv_signal    - Wake up one thread that's sleeping on this CV.
+ *    cv_broadcast - Wake up all threads sleeping on this CV.
+ *    cv_timedwait - Like cv_wait, but give up waiting after timeout_ms
+ *                   milliseconds, at most about one clock tick
+ *                   late. Returns false if it timed out. Threads in
+ *                   cv_timedwait are signalled before those in
+ *                   cv_wait, and are woken at once rather than on
+ *                   lock_release.
+ *
+ * For all three operations, the current thread must hold the lock passed 
+ * in. Note that under normal circumstances the same lock should be used
+ * on all operations with any particular CV.
+ *
+ * Signalled threads are not woken until the lock is released, and then
+ * one per lock_release ("wait morphing"), so they do not wake up only
+ * to block on the lock. This requires that a CV always be used with
+ * the same lock.
+ *
+ * These operations must be atomic. You get to write them.
+ */
+void cv_wait(struct cv *cv, struct lock *lock);
+void cv_signal(struct cv *cv, struct lock *lock);
+void cv_broadcast(struct cv *cv, struct lock *lock);
+bool cv_timedwait(struct cv *cv, struct lock *lock, unsigned timeout_ms);
+
+/*
+ * Wake timed waiters (P_timeout, cv_timedwait) whose time is up.
+ * Called from the clock interrupt on every hardclock tick.
+ */
+void synch_clock(void);
+
+
+/*
+ * Reader-writer lock.
+ *
+ * Any number of threads may hold the lock for reading at once, or one
+ * thread may hold it for writing. Writers are preferred: once a writer
+ * is waiting, new readers wait behind it, so a steady stream of readers
+ * cannot starve writers. Read holds are not recursive for the same
+ * reason - a reader that asks again while a writer waits deadlocks.
+ *
+ * The name field is for easier debugging. A copy of the name is
+ * made internally.
+ */
+
+struct rwlock {
+        char *rw_name;
+	struct spinlock rw_spin;
+	struct wchan *rw_rwchan;	/* readers waiting */
+	struct wchan *rw_wwchan;	/* writers waiting */
+	struct wchan *rw_uwchan;	/* the upgrading reader */
+	unsigned rw_readers;		/* current read holds */
+	unsigned rw_rwaiting;		/* sleepers on rw_rwchan */
+	unsigned rw_wwaiting;		/* sleepers on rw_wwchan */
+	struct thread *rw_writer;	/* write holder, if any */
+	bool rw_upgrading;		/* a reader is in rwlock_upgrade */
+};
+
+struct rwlock *rwlock_create(const char *name);
+void rwlock_destroy(struct rwlock *);
+
+/*
+ * Operations:
+ *    rwlock_acquire_read  - Get the lock for reading.
+ *    rwlock_release_read  - Give up a read hold.
+ *    rwlock_acquire_write - Get the lock for writing.
+ *    rwlock_release_write - Give up the write hold.
+ *    rwlock_upgrade       - Turn the caller's read hold into the write
+ *                           hold, waiting for the other readers to
+ *                           leave. Only one reader can upgrade at a
+ *                           time; if another already is, the caller's
+ *                           read hold is released and false is
+ *                           returned, and the caller must use
+ *                           rwlock_acquire_write and look again.
+ *    rwlock_downgrade     - Turn the write hold into a read hold
+ *                           without letting any writer in between.
+ *    rwlock_do_i_write    - Return true if the current thread holds
+ *                           the lock for writing.
+ */
+void rwlock_acquire_read(struct rwlock *);
+void rwlock_release_read(struct rwlock *);
+void rwlock_acquire_write(struct rwlock *);
+void rwlock_release_write(struct rwlock *);
+bool rwlock_upgrade(struct rwlock *);
+void rwlock_downgrade(struct rwlock *);
+bool rwlock_do_i_write(struct rwlock *);
+
+
+/*
+ * Sequence lock.
+ *
+ * For small, read-mostly data that readers can simply copy. Writers
+ * serialize on sl_lock and bump sl_seq before and after changing the
+ * data, so it is odd while a write is in progress. Readers take no
+ * lock at all: they note sl_seq, copy the data, and try again if sl_seq
+ * was odd or has changed since. Readers therefore never block a writer
+ * and never sleep, and may be used where sleeping is not allowed, but
+ * must not follow pointers in data that may be changing under them.
+ *
+ * A seqlock lives inside the structure it protects, like a spinlock.
+ *
+ * Usage:
+ *    do {
+ *            seq = seqlock_read_begin(&sl);
+ *            copy = data;
+ *    } while (seqlock_read_retry(&sl, seq));
+ */
+
+struct seqlock {
+	struct spinlock sl_lock;	/* serializes writers */
+	volatile unsigned sl_seq;	/* odd while a write is in progress */
+};
+
+#define SEQLOCK_INITIALIZER	{ SPINLOCK_INITIALIZER, 0 }
+
+void seqlock_init(struct seqlock *);
+void seqlock_cleanup(struct seqlock *);
+
+/*
+ * Operations:
+ *    seqlock_read_begin - Start a read; returns the sequence number to
+ *                         pass to seqlock_read_retry.
+ *    seqlock_read_retry - Return true if the data read since
+ *                         seqlock_read_begin may be torn and must be
+ *                         read again.
+ *    seqlock_write_begin - Start changing the data. Like a spinlock,
+ *                         this must not be held across anything that
+ *                         sleeps.
+ *    seqlock_write_end  - Finish changing the data.
+ */
+unsigned seqlock_read_begin(const struct seqlock *);
+bool seqlock_read_retry(const struct seqlock *, unsigned seq);
+void seqlock_write_begin(struct seqlock *);
+void seqlock_write_end(struct seqlock *);
+
+
+#endif /* _SYNCH_H_ */
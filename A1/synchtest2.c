@@ -0,0 +1,1027 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * More synchronization tests and benchmarks, for the additions to the
+ * primitives described in synch.h.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <clock.h>
+#include <spinlock.h>
+#include <wchan.h>
+#include <thread.h>
+#include <current.h>
+#include <synch.h>
+#include <test.h>
+
+#define BENCH_OPS 100000	/* default acquire/release pairs per thread */
+
+/* Nanoseconds since secs/nsecs. */
+static
+unsigned long
+ns_since(time_t secs, uint32_t nsecs)
+{
+	time_t nowsecs, dsecs;
+	uint32_t nownsecs, dnsecs;
+
+	gettime(&nowsecs, &nownsecs);
+	getinterval(secs, nsecs, nowsecs, nownsecs, &dsecs, &dnsecs);
+	return (unsigned long)dsecs * 1000000000 + dnsecs;
+}
+
+/*
+ * Wait until *count reaches n. Used with a primitive's count of
+ * sleepers to know that the nth waiter has gone to sleep.
+ */
+static
+void
+wait_for(volatile unsigned *count, unsigned n)
+{
+	while (*count < n) {
+		thread_yield();
+	}
+}
+
+////////////////////////////////////////////////////////////
+//
+// Lock benchmark.
+
+static struct lock *bench_lock;
+static struct semaphore *bench_done;
+static volatile unsigned long bench_counter;
+
+/*
+ * The uncontended path locks took before lk_word: a bool guarded by
+ * lk_spin, with a wakeup attempt on every release. Kept here so sy4
+ * can report the old and new costs side by side.
+ */
+struct oldlock {
+	struct spinlock ol_spin;
+	struct wchan *ol_wchan;
+	struct thread *volatile ol_holder;
+	volatile bool ol_locked;
+};
+
+static
+void
+oldlock_acquire(struct oldlock *ol)
+{
+	spinlock_acquire(&ol->ol_spin);
+	KASSERT(!ol->ol_locked);	/* only ever uncontended here */
+	ol->ol_holder = curthread;
+	ol->ol_locked = true;
+	spinlock_release(&ol->ol_spin);
+}
+
+static
+void
+oldlock_release(struct oldlock *ol)
+{
+	spinlock_acquire(&ol->ol_spin);
+	ol->ol_holder = NULL;
+	ol->ol_locked = false;
+	wchan_wakeone(ol->ol_wchan);
+	spinlock_release(&ol->ol_spin);
+}
+
+static
+void
+lockbench_thread(void *junk, unsigned long ops)
+{
+	(void)junk;
+
+	for (unsigned long i = 0; i < ops; i++) {
+		lock_acquire(bench_lock);
+		bench_counter++;
+		lock_release(bench_lock);
+	}
+	V(bench_done);
+}
+
+/*
+ * sy4 [ops]: time lock_acquire/lock_release pairs, first from one
+ * thread with the lock always free - both the ll/sc fast path and,
+ * for comparison, the lk_spin path it replaced - then from
+ * 2, 4 and 8 threads competing for it (the adaptive spin and sleep
+ * paths). The contended figures depend on how many CPUs sys161 is
+ * configured with. The shared counter checks mutual exclusion.
+ */
+int
+lockbench(int nargs, char **args)
+{
+	static const unsigned nthreads[] = { 2, 4, 8 };
+	unsigned long ops = BENCH_OPS;
+	time_t secs;
+	uint32_t nsecs;
+	unsigned long ns, oldns;
+	struct oldlock ol;
+	bool ok = true;
+
+	if (nargs > 1) {
+		ops = atoi(args[1]);
+	}
+	if (ops == 0) {
+		return EINVAL;
+	}
+	bench_lock = lock_create("lockbench");
+	bench_done = sem_create("lockbench_done", 0);
+	ol.ol_wchan = wchan_create("lockbench_old");
+	if (bench_lock == NULL || bench_done == NULL || ol.ol_wchan == NULL) {
+		panic("lockbench: out of memory\n");
+	}
+	spinlock_init(&ol.ol_spin);
+	ol.ol_holder = NULL;
+	ol.ol_locked = false;
+
+	gettime(&secs, &nsecs);
+	for (unsigned long i = 0; i < ops; i++) {
+		oldlock_acquire(&ol);
+		oldlock_release(&ol);
+	}
+	oldns = ns_since(secs, nsecs);
+	spinlock_cleanup(&ol.ol_spin);
+	wchan_destroy(ol.ol_wchan);
+
+	gettime(&secs, &nsecs);
+	for (unsigned long i = 0; i < ops; i++) {
+		lock_acquire(bench_lock);
+		lock_release(bench_lock);
+	}
+	ns = ns_since(secs, nsecs);
+	kprintf("lockbench: uncontended: %lu ns per acquire/release "
+		"(lk_spin path: %lu ns)\n", ns / ops, oldns / ops);
+
+	for (unsigned t = 0; t < sizeof(nthreads) / sizeof(nthreads[0]); t++) {
+		bench_counter = 0;
+		gettime(&secs, &nsecs);
+		for (unsigned i = 0; i < nthreads[t]; i++) {
+			if (thread_fork("lockbench", NULL, lockbench_thread,
+					NULL, ops)) {
+				panic("lockbench: thread_fork failed\n");
+			}
+		}
+		for (unsigned i = 0; i < nthreads[t]; i++) {
+			P(bench_done);
+		}
+		ns = ns_since(secs, nsecs);
+		kprintf("lockbench: %u threads: %lu ns per acquire/release\n",
+			nthreads[t], ns / (ops * nthreads[t]));
+		if (bench_counter != ops * nthreads[t]) {
+			kprintf("lockbench: counter is %lu, expected %lu\n",
+				bench_counter, ops * nthreads[t]);
+			ok = false;
+		}
+	}
+
+	lock_destroy(bench_lock);
+	sem_destroy(bench_done);
+	kprintf("lockbench: %s\n", ok ? "passed" : "FAILED");
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+//
+// Handoff (FIFO) test.
+
+#define FIFO_THREADS 8
+
+static struct lock *fifo_lock;
+static struct semaphore *fifo_sem;
+static struct semaphore *fifo_recorded;
+static struct semaphore *fifo_done;
+static volatile unsigned long fifo_order[FIFO_THREADS];
+static volatile unsigned fifo_next;
+
+static
+void
+fifo_lock_thread(void *junk, unsigned long id)
+{
+	(void)junk;
+
+	lock_acquire(fifo_lock);
+	fifo_order[fifo_next++] = id;
+	lock_release(fifo_lock);
+	V(fifo_done);
+}
+
+static
+void
+fifo_sem_thread(void *junk, unsigned long id)
+{
+	(void)junk;
+
+	P(fifo_sem);
+	fifo_order[fifo_next++] = id;
+	V(fifo_recorded);
+	V(fifo_done);
+}
+
+/* Check that the threads got through in the order they queued. */
+static
+bool
+fifo_check(const char *what)
+{
+	for (unsigned i = 0; i < FIFO_THREADS; i++) {
+		if (fifo_order[i] != i) {
+			kprintf("handofftest: %s: thread %lu went %uth\n",
+				what, fifo_order[i], i);
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * sy5: queue FIFO_THREADS threads, one at a time, on a handoff lock
+ * and then on a handoff semaphore, and check that they are let
+ * through in the order they went to sleep.
+ */
+int
+handofftest(int nargs, char **args)
+{
+	bool ok = true;
+
+	(void)nargs;
+	(void)args;
+
+	fifo_lock = lock_create_handoff("handofftest");
+	fifo_sem = sem_create_handoff("handofftest", 0);
+	fifo_recorded = sem_create("handofftest_recorded", 0);
+	fifo_done = sem_create("handofftest_done", 0);
+	if (fifo_lock == NULL || fifo_sem == NULL ||
+	    fifo_recorded == NULL || fifo_done == NULL) {
+		panic("handofftest: out of memory\n");
+	}
+
+	/* lock: each thread holds it briefly, so grants are serialized */
+	fifo_next = 0;
+	lock_acquire(fifo_lock);
+	for (unsigned long i = 0; i < FIFO_THREADS; i++) {
+		if (thread_fork("handofftest", NULL, fifo_lock_thread,
+				NULL, i)) {
+			panic("handofftest: thread_fork failed\n");
+		}
+		wait_for(&fifo_lock->lk_waiters, i + 1);
+	}
+	lock_release(fifo_lock);
+	for (unsigned i = 0; i < FIFO_THREADS; i++) {
+		P(fifo_done);
+	}
+	ok = fifo_check("lock") && ok;
+
+	/* semaphore: V one unit at a time and see who got it */
+	fifo_next = 0;
+	for (unsigned long i = 0; i < FIFO_THREADS; i++) {
+		if (thread_fork("handofftest", NULL, fifo_sem_thread,
+				NULL, i)) {
+			panic("handofftest: thread_fork failed\n");
+		}
+		wait_for(&fifo_sem->sem_waiters, i + 1);
+	}
+	for (unsigned i = 0; i < FIFO_THREADS; i++) {
+		V(fifo_sem);
+		P(fifo_recorded);
+	}
+	for (unsigned i = 0; i < FIFO_THREADS; i++) {
+		P(fifo_done);
+	}
+	ok = fifo_check("semaphore") && ok;
+
+	lock_destroy(fifo_lock);
+	sem_destroy(fifo_sem);
+	sem_destroy(fifo_recorded);
+	sem_destroy(fifo_done);
+	kprintf("handofftest: %s\n", ok ? "passed" : "FAILED");
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+//
+// Reader-writer lock test.
+
+#define RWT_THREADS 8
+#define RWT_ROUNDS 100		/* upgrade races */
+#define RWT_LOOPS 1000		/* stress iterations per thread */
+
+static struct rwlock *rwt_lock;
+static struct semaphore *rwt_inside;
+static struct semaphore *rwt_go;
+static struct semaphore *rwt_done;
+static struct spinlock rwt_spin = SPINLOCK_INITIALIZER;
+static volatile unsigned rwt_readers_in;
+static volatile unsigned rwt_writers_in;
+static volatile unsigned rwt_wins;
+static volatile unsigned rwt_errors;
+static volatile char rwt_order[2];
+static volatile unsigned rwt_next;
+
+/* Hold a read lock until main has seen everyone inside. */
+static
+void
+rwt_reader(void *junk, unsigned long num)
+{
+	(void)junk;
+	(void)num;
+
+	rwlock_acquire_read(rwt_lock);
+	V(rwt_inside);
+	P(rwt_go);
+	rwlock_release_read(rwt_lock);
+	V(rwt_done);
+}
+
+/* Record which kind of thread got the lock first. */
+static
+void
+rwt_recorder(void *junk, unsigned long writer)
+{
+	(void)junk;
+
+	if (writer) {
+		rwlock_acquire_write(rwt_lock);
+		rwt_order[rwt_next++] = 'W';
+		rwlock_release_write(rwt_lock);
+	}
+	else {
+		rwlock_acquire_read(rwt_lock);
+		rwt_order[rwt_next++] = 'R';
+		rwlock_release_read(rwt_lock);
+	}
+	V(rwt_done);
+}
+
+/* Take a read hold alongside the other racer, then both upgrade. */
+static
+void
+rwt_upgrader(void *junk, unsigned long num)
+{
+	(void)junk;
+	(void)num;
+
+	rwlock_acquire_read(rwt_lock);
+	V(rwt_inside);
+	P(rwt_go);
+	if (rwlock_upgrade(rwt_lock)) {
+		KASSERT(rwlock_do_i_write(rwt_lock));
+		rwt_wins++;
+		rwlock_release_write(rwt_lock);
+	}
+	V(rwt_done);
+}
+
+/* Note entry to and exit from the lock, checking exclusion. */
+static
+void
+rwt_enter(bool writer)
+{
+	spinlock_acquire(&rwt_spin);
+	if (rwt_writers_in > 0 || (writer && rwt_readers_in > 0)) {
+		rwt_errors++;
+	}
+	if (writer) {
+		rwt_writers_in++;
+	}
+	else {
+		rwt_readers_in++;
+	}
+	spinlock_release(&rwt_spin);
+}
+
+static
+void
+rwt_leave(bool writer)
+{
+	spinlock_acquire(&rwt_spin);
+	if (writer) {
+		rwt_writers_in--;
+	}
+	else {
+		rwt_readers_in--;
+	}
+	spinlock_release(&rwt_spin);
+}
+
+/* Mostly reads, with some writes and upgrades mixed in. */
+static
+void
+rwt_stress(void *junk, unsigned long num)
+{
+	(void)junk;
+
+	for (unsigned long i = 0; i < RWT_LOOPS; i++) {
+		switch ((i + num) % 8) {
+		    case 0:
+			rwlock_acquire_write(rwt_lock);
+			rwt_enter(true);
+			thread_yield();
+			rwt_leave(true);
+			rwlock_release_write(rwt_lock);
+			break;
+		    case 1:
+			rwlock_acquire_read(rwt_lock);
+			if (rwlock_upgrade(rwt_lock)) {
+				rwt_enter(true);
+				rwt_leave(true);
+				rwlock_downgrade(rwt_lock);
+				rwt_enter(false);
+				rwt_leave(false);
+				rwlock_release_read(rwt_lock);
+			}
+			break;
+		    default:
+			rwlock_acquire_read(rwt_lock);
+			rwt_enter(false);
+			thread_yield();
+			rwt_leave(false);
+			rwlock_release_read(rwt_lock);
+			break;
+		}
+	}
+	V(rwt_done);
+}
+
+static
+void
+rwt_fork(void (*func)(void *, unsigned long), unsigned long num)
+{
+	if (thread_fork("rwlocktest", NULL, func, NULL, num)) {
+		panic("rwlocktest: thread_fork failed\n");
+	}
+}
+
+/*
+ * sy6: check the reader-writer lock.
+ *  - readers share it: RWT_THREADS readers are all inside at once;
+ *  - writers are preferred: with a reader inside and a writer
+ *    waiting, a newly arriving reader waits behind the writer;
+ *  - downgrading lets a waiting reader in at once;
+ *  - when two readers race to upgrade, exactly one wins and the
+ *    other loses its read hold;
+ *  - a stress run of mixed reads, writes and upgrades never has a
+ *    writer inside with anyone else.
+ */
+int
+rwlocktest(int nargs, char **args)
+{
+	bool ok = true;
+
+	(void)nargs;
+	(void)args;
+
+	rwt_lock = rwlock_create("rwlocktest");
+	rwt_inside = sem_create("rwlocktest_inside", 0);
+	rwt_go = sem_create("rwlocktest_go", 0);
+	rwt_done = sem_create("rwlocktest_done", 0);
+	if (rwt_lock == NULL || rwt_inside == NULL || rwt_go == NULL ||
+	    rwt_done == NULL) {
+		panic("rwlocktest: out of memory\n");
+	}
+
+	/* shared reads */
+	for (unsigned long i = 0; i < RWT_THREADS; i++) {
+		rwt_fork(rwt_reader, i);
+	}
+	for (unsigned i = 0; i < RWT_THREADS; i++) {
+		P(rwt_inside);
+	}
+	if (rwt_lock->rw_readers != RWT_THREADS) {
+		kprintf("rwlocktest: %u readers inside, expected %u\n",
+			rwt_lock->rw_readers, RWT_THREADS);
+		ok = false;
+	}
+	for (unsigned i = 0; i < RWT_THREADS; i++) {
+		V(rwt_go);
+	}
+	for (unsigned i = 0; i < RWT_THREADS; i++) {
+		P(rwt_done);
+	}
+
+	/* writer preference */
+	rwt_next = 0;
+	rwlock_acquire_read(rwt_lock);
+	rwt_fork(rwt_recorder, 1);
+	wait_for(&rwt_lock->rw_wwaiting, 1);
+	rwt_fork(rwt_recorder, 0);
+	wait_for(&rwt_lock->rw_rwaiting, 1);
+	rwlock_release_read(rwt_lock);
+	P(rwt_done);
+	P(rwt_done);
+	if (rwt_order[0] != 'W' || rwt_order[1] != 'R') {
+		kprintf("rwlocktest: waiting reader got in before the "
+			"waiting writer\n");
+		ok = false;
+	}
+
+	/* downgrade */
+	rwt_next = 0;
+	rwlock_acquire_write(rwt_lock);
+	rwt_fork(rwt_recorder, 0);
+	wait_for(&rwt_lock->rw_rwaiting, 1);
+	rwlock_downgrade(rwt_lock);
+	/* the reader must get in while we still hold our read */
+	P(rwt_done);
+	rwlock_release_read(rwt_lock);
+
+	/* upgrade races */
+	for (unsigned r = 0; r < RWT_ROUNDS; r++) {
+		rwt_wins = 0;
+		rwt_fork(rwt_upgrader, 0);
+		rwt_fork(rwt_upgrader, 1);
+		P(rwt_inside);
+		P(rwt_inside);
+		V(rwt_go);
+		V(rwt_go);
+		P(rwt_done);
+		P(rwt_done);
+		if (rwt_wins != 1) {
+			kprintf("rwlocktest: round %u: %u upgrades won\n",
+				r, rwt_wins);
+			ok = false;
+			break;
+		}
+		if (rwt_lock->rw_readers != 0 || rwt_lock->rw_writer != NULL) {
+			kprintf("rwlocktest: round %u: lock left held\n", r);
+			ok = false;
+			break;
+		}
+	}
+
+	/* stress */
+	rwt_errors = 0;
+	for (unsigned long i = 0; i < RWT_THREADS; i++) {
+		rwt_fork(rwt_stress, i);
+	}
+	for (unsigned i = 0; i < RWT_THREADS; i++) {
+		P(rwt_done);
+	}
+	if (rwt_errors > 0) {
+		kprintf("rwlocktest: %u exclusion violations\n", rwt_errors);
+		ok = false;
+	}
+
+	rwlock_destroy(rwt_lock);
+	sem_destroy(rwt_inside);
+	sem_destroy(rwt_go);
+	sem_destroy(rwt_done);
+	kprintf("rwlocktest: %s\n", ok ? "passed" : "FAILED");
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+//
+// Reader-writer lock benchmark.
+
+#define RWB_OPS 20000		/* default read sections per thread */
+#define RWB_WORDS 64		/* size of the data each read looks at */
+
+static struct rwlock *rwb_rwlock;
+static struct lock *rwb_lock;
+static struct semaphore *rwb_done;
+static volatile unsigned long rwb_data[RWB_WORDS];
+static volatile unsigned long rwb_sums;
+
+/* A read-side critical section long enough for sharing to matter. */
+static
+unsigned long
+rwb_read(void)
+{
+	unsigned long sum = 0;
+
+	for (unsigned i = 0; i < RWB_WORDS; i++) {
+		sum += rwb_data[i];
+	}
+	return sum;
+}
+
+static
+void
+rwb_rwlock_thread(void *junk, unsigned long ops)
+{
+	unsigned long sum = 0;
+
+	(void)junk;
+
+	for (unsigned long i = 0; i < ops; i++) {
+		rwlock_acquire_read(rwb_rwlock);
+		sum += rwb_read();
+		rwlock_release_read(rwb_rwlock);
+	}
+	rwb_sums += sum;
+	V(rwb_done);
+}
+
+static
+void
+rwb_lock_thread(void *junk, unsigned long ops)
+{
+	unsigned long sum = 0;
+
+	(void)junk;
+
+	for (unsigned long i = 0; i < ops; i++) {
+		lock_acquire(rwb_lock);
+		sum += rwb_read();
+		lock_release(rwb_lock);
+	}
+	rwb_sums += sum;
+	V(rwb_done);
+}
+
+/* Run nthreads copies of func and return the ns per read section. */
+static
+unsigned long
+rwb_run(void (*func)(void *, unsigned long), unsigned nthreads,
+	unsigned long ops)
+{
+	time_t secs;
+	uint32_t nsecs;
+
+	gettime(&secs, &nsecs);
+	for (unsigned i = 0; i < nthreads; i++) {
+		if (thread_fork("rwlockbench", NULL, func, NULL, ops)) {
+			panic("rwlockbench: thread_fork failed\n");
+		}
+	}
+	for (unsigned i = 0; i < nthreads; i++) {
+		P(rwb_done);
+	}
+	return ns_since(secs, nsecs) / (ops * nthreads);
+}
+
+/*
+ * sy7 [ops]: time read-only critical sections from 1, 2, 4 and 8
+ * threads, once under the rwlock and once under a plain lock. With
+ * more than one CPU the rwlock figures should stay roughly flat as
+ * readers are added, while the lock figures do not.
+ */
+int
+rwlockbench(int nargs, char **args)
+{
+	static const unsigned nthreads[] = { 1, 2, 4, 8 };
+	unsigned long ops = RWB_OPS;
+
+	if (nargs > 1) {
+		ops = atoi(args[1]);
+	}
+	if (ops == 0) {
+		return EINVAL;
+	}
+	rwb_rwlock = rwlock_create("rwlockbench");
+	rwb_lock = lock_create("rwlockbench");
+	rwb_done = sem_create("rwlockbench_done", 0);
+	if (rwb_rwlock == NULL || rwb_lock == NULL || rwb_done == NULL) {
+		panic("rwlockbench: out of memory\n");
+	}
+	for (unsigned i = 0; i < RWB_WORDS; i++) {
+		rwb_data[i] = i;
+	}
+
+	for (unsigned t = 0; t < sizeof(nthreads) / sizeof(nthreads[0]); t++) {
+		kprintf("rwlockbench: %u readers: rwlock %lu ns, "
+			"lock %lu ns per read\n", nthreads[t],
+			rwb_run(rwb_rwlock_thread, nthreads[t], ops),
+			rwb_run(rwb_lock_thread, nthreads[t], ops));
+	}
+
+	rwlock_destroy(rwb_rwlock);
+	lock_destroy(rwb_lock);
+	sem_destroy(rwb_done);
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+//
+// Try and timed variants.
+
+#define TIMED_SLACK_MS 50	/* allowed lateness, a few clock ticks */
+#define TIMED_LONG_MS 5000	/* a timeout that should never run out */
+#define TIMED_THREADS 8
+#define TIMED_LOOPS 100		/* P_timeout calls per contention thread */
+
+static struct semaphore *timed_sem;
+static struct semaphore *timed_never;	/* never V'd; for sleeping */
+static struct semaphore *timed_held;
+static struct semaphore *timed_go;
+static struct semaphore *timed_done;
+static struct lock *timed_lock;
+static struct cv *timed_cv;
+static volatile bool timed_flag;
+static volatile unsigned timed_waiting;
+static volatile unsigned timed_signalled;
+static volatile unsigned long timed_got;
+
+/* Sleep for about ms milliseconds. */
+static
+void
+timed_sleep(unsigned ms)
+{
+	if (P_timeout(timed_never, ms)) {
+		panic("timedtest: got a unit nobody posted\n");
+	}
+}
+
+static
+unsigned long
+ms_since(time_t secs, uint32_t nsecs)
+{
+	return ns_since(secs, nsecs) / 1000000;
+}
+
+/* Check that a wait that timed out lasted about as long as asked. */
+static
+bool
+timed_check(const char *what, unsigned ms, unsigned long took)
+{
+	if (took < ms || took > ms + TIMED_SLACK_MS) {
+		kprintf("timedtest: %s(%u ms) took %lu ms\n", what, ms, took);
+		return false;
+	}
+	return true;
+}
+
+static
+void
+timed_holder(void *junk, unsigned long num)
+{
+	(void)junk;
+	(void)num;
+
+	lock_acquire(timed_lock);
+	V(timed_held);
+	P(timed_go);
+	lock_release(timed_lock);
+	V(timed_done);
+}
+
+static
+void
+timed_poster(void *junk, unsigned long ms)
+{
+	(void)junk;
+
+	timed_sleep(ms);
+	V(timed_sem);
+}
+
+static
+void
+timed_signaller(void *junk, unsigned long ms)
+{
+	(void)junk;
+
+	timed_sleep(ms);
+	lock_acquire(timed_lock);
+	timed_flag = true;
+	cv_signal(timed_cv, timed_lock);
+	lock_release(timed_lock);
+}
+
+static
+void
+timed_broadcast_waiter(void *junk, unsigned long num)
+{
+	(void)junk;
+	(void)num;
+
+	lock_acquire(timed_lock);
+	timed_waiting++;
+	if (cv_timedwait(timed_cv, timed_lock, TIMED_LONG_MS)) {
+		timed_signalled++;
+	}
+	lock_release(timed_lock);
+	V(timed_done);
+}
+
+static
+void
+timed_consumer(void *junk, unsigned long num)
+{
+	unsigned long got = 0;
+
+	(void)junk;
+
+	for (unsigned long i = 0; i < TIMED_LOOPS; i++) {
+		if (P_timeout(timed_sem, 1 + (i + num) % 5)) {
+			got++;
+		}
+	}
+	lock_acquire(timed_lock);
+	timed_got += got;
+	lock_release(timed_lock);
+	V(timed_done);
+}
+
+static
+void
+timed_fork(void (*func)(void *, unsigned long), unsigned long arg)
+{
+	if (thread_fork("timedtest", NULL, func, NULL, arg)) {
+		panic("timedtest: thread_fork failed\n");
+	}
+}
+
+/*
+ * sy8: check sem_tryP, lock_tryacquire, P_timeout and cv_timedwait.
+ *  - the try variants succeed or fail at once as they should;
+ *  - a timed wait that runs out returns false after at least its
+ *    timeout and less than TIMED_SLACK_MS later;
+ *  - a V or cv_signal before the deadline ends the wait early with
+ *    true, and cv_broadcast wakes every timed waiter;
+ *  - with threads racing P_timeout's short timeouts against V, no
+ *    unit is lost or handed out twice.
+ */
+int
+timedtest(int nargs, char **args)
+{
+	static const unsigned timeouts[] = { 10, 50, 200 };
+	time_t secs;
+	uint32_t nsecs;
+	unsigned long took, posted, left;
+	bool ok = true;
+
+	(void)nargs;
+	(void)args;
+
+	timed_sem = sem_create("timedtest", 0);
+	timed_never = sem_create("timedtest_never", 0);
+	timed_held = sem_create("timedtest_held", 0);
+	timed_go = sem_create("timedtest_go", 0);
+	timed_done = sem_create("timedtest_done", 0);
+	timed_lock = lock_create("timedtest");
+	timed_cv = cv_create("timedtest");
+	if (timed_sem == NULL || timed_never == NULL || timed_held == NULL ||
+	    timed_go == NULL || timed_done == NULL || timed_lock == NULL ||
+	    timed_cv == NULL) {
+		panic("timedtest: out of memory\n");
+	}
+
+	/* try variants */
+	if (sem_tryP(timed_sem)) {
+		kprintf("timedtest: sem_tryP got a unit from count 0\n");
+		ok = false;
+	}
+	V(timed_sem);
+	if (!sem_tryP(timed_sem)) {
+		kprintf("timedtest: sem_tryP failed with count 1\n");
+		ok = false;
+	}
+	timed_fork(timed_holder, 0);
+	P(timed_held);
+	if (lock_tryacquire(timed_lock)) {
+		kprintf("timedtest: lock_tryacquire got a held lock\n");
+		lock_release(timed_lock);
+		ok = false;
+	}
+	V(timed_go);
+	P(timed_done);
+	if (!lock_tryacquire(timed_lock)) {
+		kprintf("timedtest: lock_tryacquire failed on a free lock\n");
+		ok = false;
+	}
+	else {
+		lock_release(timed_lock);
+	}
+
+	/* timeouts */
+	for (unsigned i = 0; i < sizeof(timeouts) / sizeof(timeouts[0]); i++) {
+		gettime(&secs, &nsecs);
+		if (P_timeout(timed_sem, timeouts[i])) {
+			kprintf("timedtest: P_timeout got a unit from "
+				"count 0\n");
+			ok = false;
+		}
+		took = ms_since(secs, nsecs);
+		ok = timed_check("P_timeout", timeouts[i], took) && ok;
+
+		lock_acquire(timed_lock);
+		gettime(&secs, &nsecs);
+		if (cv_timedwait(timed_cv, timed_lock, timeouts[i])) {
+			kprintf("timedtest: cv_timedwait was signalled\n");
+			ok = false;
+		}
+		took = ms_since(secs, nsecs);
+		lock_release(timed_lock);
+		ok = timed_check("cv_timedwait", timeouts[i], took) && ok;
+	}
+
+	/* woken early */
+	gettime(&secs, &nsecs);
+	timed_fork(timed_poster, timeouts[0]);
+	if (!P_timeout(timed_sem, TIMED_LONG_MS)) {
+		kprintf("timedtest: P_timeout missed a V\n");
+		ok = false;
+	}
+	took = ms_since(secs, nsecs);
+	if (took > timeouts[0] + TIMED_SLACK_MS) {
+		kprintf("timedtest: P_timeout took %lu ms to see a V\n",
+			took);
+		ok = false;
+	}
+
+	timed_flag = false;
+	lock_acquire(timed_lock);
+	gettime(&secs, &nsecs);
+	timed_fork(timed_signaller, timeouts[0]);
+	while (!timed_flag) {
+		if (!cv_timedwait(timed_cv, timed_lock, TIMED_LONG_MS)) {
+			kprintf("timedtest: cv_timedwait missed a signal\n");
+			ok = false;
+			break;
+		}
+	}
+	took = ms_since(secs, nsecs);
+	lock_release(timed_lock);
+	if (took > timeouts[0] + TIMED_SLACK_MS) {
+		kprintf("timedtest: cv_timedwait took %lu ms to see a "
+			"signal\n", took);
+		ok = false;
+	}
+
+	/* broadcast */
+	timed_waiting = 0;
+	timed_signalled = 0;
+	for (unsigned long i = 0; i < TIMED_THREADS; i++) {
+		timed_fork(timed_broadcast_waiter, i);
+	}
+	lock_acquire(timed_lock);
+	while (timed_waiting < TIMED_THREADS) {
+		lock_release(timed_lock);
+		thread_yield();
+		lock_acquire(timed_lock);
+	}
+	cv_broadcast(timed_cv, timed_lock);
+	lock_release(timed_lock);
+	for (unsigned i = 0; i < TIMED_THREADS; i++) {
+		P(timed_done);
+	}
+	if (timed_signalled != TIMED_THREADS) {
+		kprintf("timedtest: cv_broadcast woke %u of %u\n",
+			timed_signalled, TIMED_THREADS);
+		ok = false;
+	}
+
+	/* contention: every unit posted is either taken or still there */
+	timed_got = 0;
+	posted = 0;
+	for (unsigned long i = 0; i < TIMED_THREADS; i++) {
+		timed_fork(timed_consumer, i);
+	}
+	for (unsigned i = 0; i < TIMED_THREADS * TIMED_LOOPS / 2; i++) {
+		V(timed_sem);
+		posted++;
+		if (i % 8 == 0) {
+			timed_sleep(1);
+		}
+	}
+	for (unsigned i = 0; i < TIMED_THREADS; i++) {
+		P(timed_done);
+	}
+	left = 0;
+	while (sem_tryP(timed_sem)) {
+		left++;
+	}
+	if (timed_got + left != posted) {
+		kprintf("timedtest: posted %lu, taken %lu, left %lu\n",
+			posted, timed_got, left);
+		ok = false;
+	}
+
+	sem_destroy(timed_sem);
+	sem_destroy(timed_never);
+	sem_destroy(timed_held);
+	sem_destroy(timed_go);
+	sem_destroy(timed_done);
+	lock_destroy(timed_lock);
+	cv_destroy(timed_cv);
+	kprintf("timedtest: %s\n", ok ? "passed" : "FAILED");
+	return 0;
+}
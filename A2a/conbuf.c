@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/*
+ * Console output buffer for user processes' stdout and stderr.
+ */
+#include <types.h>
+#include <kern/fcntl.h>
+#include <lib.h>
+#include <uio.h>
+#include <vnode.h>
+#include <vfs.h>
+#include <copyinout.h>
+#include <synch.h>
+#include <thread.h>
+#include <current.h>
+#include <proc.h>
+#include <conbuf.h>
+#include "opt-A2.h"
+#if OPT_A2
+/* the console vnode shared by every user process, opened on first use */
+static struct vnode *shared_console;
+/*
+ * Buffered console output. Writes to stdout/stderr are copied into
+ * conbuf and return straight away; a flusher thread drains the buffer
+ * into shared_console. Writers block while the buffer is full, so
+ * output-heavy programs are held to the speed of the console instead
+ * of using unbounded memory. conbufHead and conbufTail count every
+ * byte ever appended and drained; only their difference matters, so
+ * they may wrap. Each proc that has written records in conMark where
+ * its last write ended, so _exit waits only for its own output, and
+ * not at all if it never wrote.
+ */
+#define CONBUF_SIZE 4096
+static char conbuf[CONBUF_SIZE];
+static unsigned int conbufHead;
+static unsigned int conbufTail;
+static struct lock *conbufLock;
+static struct cv *conbufData;		/* flusher waits for bytes */
+static struct cv *conbufSpace;		/* writers wait for room */
+static struct cv *conbufDrained;	/* conbufFlush waits for the tail */
+// Drains conbuf into the console, one contiguous run at a time
+static void conbufFlusher(void *unused1, unsigned long unused2) {
+	struct iovec iov;
+	struct uio ku;
+	(void)unused1;
+	(void)unused2;
+	lock_acquire(conbufLock);
+	while (1) {
+		while (conbufTail == conbufHead) {
+			cv_wait(conbufData, conbufLock);
+		}
+		unsigned int start = conbufTail % CONBUF_SIZE;
+		unsigned int len = conbufHead - conbufTail;
+		if (len > CONBUF_SIZE - start) {
+			len = CONBUF_SIZE - start;
+		}
+		// writers leave these bytes alone until conbufTail passes them
+		lock_release(conbufLock);
+		uio_kinit(&iov, &ku, conbuf + start, len, 0, UIO_WRITE);
+		// nothing to report a console error to; the bytes are dropped
+		(void)VOP_WRITE(shared_console, &ku);
+		lock_acquire(conbufLock);
+		conbufTail += len;
+		cv_broadcast(conbufSpace, conbufLock);
+		cv_broadcast(conbufDrained, conbufLock);
+	}
+}
+// Appends len bytes from ubuf to the console buffer, waiting for room
+// as needed. *written is how much was taken, which is short only if
+// copyin fails part way.
+int conbufWrite(userptr_t ubuf, size_t len, size_t *written) {
+	size_t done = 0;
+	int result = 0;
+	lock_acquire(conbufLock);
+	while (done < len) {
+		while (conbufHead - conbufTail == CONBUF_SIZE) {
+			cv_wait(conbufSpace, conbufLock);
+		}
+		unsigned int start = conbufHead % CONBUF_SIZE;
+		size_t n = CONBUF_SIZE - (conbufHead - conbufTail);
+		if (n > CONBUF_SIZE - start) {
+			n = CONBUF_SIZE - start;
+		}
+		if (n > len - done) {
+			n = len - done;
+		}
+		result = copyin((userptr_t)((vaddr_t)ubuf + done), conbuf + start, n);
+		if (result) {
+			break;
+		}
+		conbufHead += n;
+		done += n;
+		cv_signal(conbufData, conbufLock);
+	}
+	if (done > 0) {
+		curproc->conMark = conbufHead;
+		curproc->conWritten = true;
+	}
+	lock_release(conbufLock);
+	*written = done;
+	return done == 0 ? result : 0;
+}
+// Waits until everything the current process wrote has reached the
+// console
+void conbufFlush(void) {
+	if (conbufLock == NULL || !curproc->conWritten) {
+		return;
+	}
+	lock_acquire(conbufLock);
+	while ((int)(conbufTail - curproc->conMark) < 0) {
+		cv_wait(conbufDrained, conbufLock);
+	}
+	lock_release(conbufLock);
+}
+// Creates the buffer's locks; called from proc_bootstrap
+void conbufBootstrap(void) {
+	conbufLock = lock_create("conbuf_lock");
+	conbufData = cv_create("conbuf_data");
+	conbufSpace = cv_create("conbuf_space");
+	conbufDrained = cv_create("conbuf_drained");
+	if (conbufLock == NULL || conbufData == NULL ||
+	    conbufSpace == NULL || conbufDrained == NULL) {
+		panic("could not create console buffer synchronization");
+	}
+}
+// Returns the shared console vnode with a reference for the caller.
+// The first call opens it and starts the flusher; callers must
+// serialize it.
+struct vnode *conbufOpen(void) {
+	char *console_path;
+	if (shared_console == NULL) {
+		console_path = kstrdup("con:");
+		if (console_path == NULL) {
+			panic("unable to copy console path name during process creation\n");
+		}
+		if (vfs_open(console_path, O_WRONLY, 0, &shared_console)) {
+			panic("unable to open the console during process creation\n");
+		}
+		kfree(console_path);
+		if (thread_fork("conbuf_flusher", kproc, conbufFlusher, NULL, 0)) {
+			panic("unable to start the console flusher\n");
+		}
+	}
+	VOP_INCREF(shared_console);
+	return shared_console;
+}
+#endif /* OPT_A2 */
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/*
+ * Kernel log ring, for diagnostics from paths that must not wait for
+ * the console.
+ */
+#include <types.h>
+#include <lib.h>
+#include <stdarg.h>
+#include <spinlock.h>
+#include <synch.h>
+#include <thread.h>
+#include <proc.h>
+#include <klog.h>
+#include "opt-A2.h"
+#if OPT_A2
+/*
+ * Kernel log ring. klogPrintf formats into the ring and returns
+ * without touching the console; a drainer thread prints the ring in
+ * the background. It takes only a spinlock, so it can be used where
+ * sleeping is not allowed. Messages that do not fit are dropped and
+ * counted rather than stalling the caller. Until the drainer has been
+ * started (with the console, on first process creation) messages go
+ * straight to kprintf.
+ */
+#define KLOG_SIZE 8192
+#define KLOG_LINE_MAX 160
+static char klog[KLOG_SIZE];
+static unsigned int klogHead;
+static unsigned int klogTail;
+static unsigned int klogDropped;
+static struct spinlock klogLock = SPINLOCK_INITIALIZER;
+static struct semaphore *klogSem;	/* V'd once per message */
+static bool klogRunning = false;
+// Queues a formatted message on the kernel log ring
+void klogPrintf(const char *fmt, ...) {
+	char line[KLOG_LINE_MAX];
+	va_list ap;
+	size_t len;
+	va_start(ap, fmt);
+	vsnprintf(line, sizeof(line), fmt, ap);
+	va_end(ap);
+	if (!klogRunning) {
+		kprintf("%s", line);
+		return;
+	}
+	len = strlen(line);
+	spinlock_acquire(&klogLock);
+	if (KLOG_SIZE - (klogHead - klogTail) < len) {
+		klogDropped++;
+		spinlock_release(&klogLock);
+		return;
+	}
+	for (size_t i = 0; i < len; i++) {
+		klog[(klogHead + i) % KLOG_SIZE] = line[i];
+	}
+	klogHead += len;
+	spinlock_release(&klogLock);
+	V(klogSem);
+}
+// Prints and consumes whatever is on the kernel log ring
+void klogDump(void) {
+	char chunk[KLOG_LINE_MAX + 1];
+	unsigned int n, dropped;
+	while (1) {
+		spinlock_acquire(&klogLock);
+		n = klogHead - klogTail;
+		if (n > KLOG_LINE_MAX) {
+			n = KLOG_LINE_MAX;
+		}
+		for (unsigned int i = 0; i < n; i++) {
+			chunk[i] = klog[(klogTail + i) % KLOG_SIZE];
+		}
+		klogTail += n;
+		dropped = klogDropped;
+		klogDropped = 0;
+		spinlock_release(&klogLock);
+		if (dropped) {
+			kprintf("[klog: %u messages dropped]\n", dropped);
+		}
+		if (n == 0) {
+			return;
+		}
+		chunk[n] = '\0';
+		kprintf("%s", chunk);
+	}
+}
+static void klogDrainer(void *unused1, unsigned long unused2) {
+	(void)unused1;
+	(void)unused2;
+	while (1) {
+		P(klogSem);
+		klogDump();
+	}
+}
+// Creates the drainer's semaphore; called from proc_bootstrap
+void klogBootstrap(void) {
+	klogSem = sem_create("klog_sem", 0);
+	if (klogSem == NULL) {
+		panic("could not create klog_sem semaphore");
+	}
+}
+// Starts the drainer the first time it is called; until then
+// klogPrintf prints directly. Callers must serialize it.
+void klogStart(void) {
+	if (klogRunning) {
+		return;
+	}
+	if (thread_fork("klog_drainer", kproc, klogDrainer, NULL, 0)) {
+		panic("unable to start the kernel log drainer\n");
+	}
+	klogRunning = true;
+}
+#endif /* OPT_A2 */
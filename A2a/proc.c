@@ -1,434 +1,779 @@
-/*
- * Copyright (c) 2013
- *	The President and Fellows of Harvard College.
- *
- * Redistribution and use in source and binary forms, with or without
- * modification, are permitted provided that the following conditions
- * are met:
- * 1. Redistributions of source code must retain the above copyright
- *    notice, this list of conditions and the following disclaimer.
- * 2. Redistributions in binary form must reproduce the above copyright
- *    notice, this list of conditions and the following disclaimer in the
- *    documentation and/or other materials provided with the distribution.
- * 3. Neither the name of the University nor the names of its contributors
- *    may be used to endorse or promote products derived from this software
- *    without specific prior written permission.
- *
- * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
- * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
- * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
- * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
- * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
- * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
- * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
- * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
- * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
- * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
- * SUCH DAMAGE.
- */
-/*
- * Process support.
- *
- * There is (intentionally) not much here; you will need to add stuff
- * and maybe change around what's already present.
- *
- * p_lock is intended to be held when manipulating the pointers in the
- * proc structure, not while doing any significant work with the
- * things they point to. Rearrange this (and/or change it to be a
- * regular lock) as needed.
- *
- * Unless you're implementing multithreaded user processes, the only
- * process that will have more than one thread is the kernel process.
- */
-#include "opt-A2.h"
-#include <types.h>
-#include <proc.h>
-#include <current.h>
-#include <addrspace.h>
-#include <vnode.h>
-#include <vfs.h>
-#include <synch.h>
-#include <kern/fcntl.h>
-#include <limits.h>
-#include <array.h>
-/*
- * The process for the kernel; this holds all the kernel-only threads.
- */
-struct proc *kproc;
-/*
- * Mechanism for making the kernel menu thread sleep while processes are running
- */
-#ifdef UW
-/* count of the number of processes, excluding kproc */
-static volatile unsigned int proc_count;
-/* provides mutual exclusion for proc_count */
-/* it would be better to use a lock here, but we use a semaphore because locks are not implemented in the base kernel */ 
-static struct semaphore *proc_count_mutex;
-/* used to signal the kernel menu thread when there are no processes */
-struct semaphore *no_proc_sem;   
-#endif  // UW
-#if OPT_A2
-pid_t pid_min = PID_MIN;
-// Creates unique PID for each new process
-pid_t createPID(void) {
-	pid_t p = pid_min++;
-	if (array_num(reusePIDList) != 0) {
-		p = ((pid_t) array_get(reusePIDList, 0));
-		array_remove(reusePIDList, 0);
-	}
-	return p;
-}
-// Given a PID, returns entry in PID Table corresponding to it
-struct pidTableEntry *returnEntry(pid_t pid) {
-	unsigned int len = array_num(pidTable);
-	for (unsigned int i = 0; i < len; ++i) {
-		struct pidTableEntry *p = array_get(pidTable, i);
-		if (p->pid == pid) {
-			return p;
-		}
-	}
-	return NULL;
-}
-// Returns true if child is child of parent
-// So returns true if child is in parent's children array
-bool isChild(pid_t parent, pid_t child) {
-	struct pidTableEntry *parentEntry = returnEntry(parent);
-	unsigned int len = array_num(parentEntry->children);
-	for (unsigned int i = 0; i < len; ++i) {
-		if ((pid_t) array_get(parentEntry->children, i) == child) {
-			// child is child of parent
-			return true;
-		}
-	}
-	return false;
-}
-//TODO: NEED TO FIX THIS FOR MEMORY
-// Removes entry corresponding to pid from PID Table
-void removeFromPidTable(pid_t pid) {
-	unsigned int len = array_num(pidTable);
-	for (unsigned int i = 0; i < len; ++i) {
-		struct pidTableEntry *p = array_get(pidTable, i);
-		if (p->pid == pid) {
-		//	kprintf("NUM CHILDREN: %d\n", array_num(p->children));
-		//	while (array_num(p->children) != 0) {
-		//		array_remove(p->children, 0);
-		//	}
-		//	array_destroy(p->children);
-		//	kfree(p);
-			array_remove(pidTable, i);
-			break;
-		}
-	}
-}
-#endif /* OPT_A2 */
-/*
- * Create a proc structure.
- */
-static
-struct proc *
-proc_create(const char *name)
-{
-	struct proc *proc;
-	proc = kmalloc(sizeof(*proc));
-	if (proc == NULL) {
-		return NULL;
-	}
-	proc->p_name = kstrdup(name);
-	if (proc->p_name == NULL) {
-		kfree(proc);
-		return NULL;
-	}
-	threadarray_init(&proc->p_threads);
-	spinlock_init(&proc->p_lock);
-	/* VM fields */
-	proc->p_addrspace = NULL;
-	/* VFS fields */
-	proc->p_cwd = NULL;
-#ifdef UW
-	proc->console = NULL;
-#endif // UW
-	return proc;
-}
-/*
- * Destroy a proc structure.
- */
-void
-proc_destroy(struct proc *proc)
-{
-	/*
-         * note: some parts of the process structure, such as the address space,
-         *  are destroyed in sys_exit, before we get here
-         *
-         * note: depending on where this function is called from, curproc may not
-         * be defined because the calling thread may have already detached itself
-         * from the process.
-	 */
-	KASSERT(proc != NULL);
-	KASSERT(proc != kproc);
-/* Running into problems when deleting process from pidTable here, need
-to think about memory management
-	// Remove process from pidTable
-	unsigned int len = array_num(pidTable);
-	for (unsigned int i = 0; i < len; ++i) {
-		struct pidTableEntry *p = array_get(pidTable, i);
-		if (p->pid == proc->pid) {
-			array_remove(pidTable, i);
-			while (array_num(p->children) != 0) {
-				array_remove(p->children, 0);
-			}
-			//array_cleanup(p->children);
-			array_destroy(p->children);
-			break;
-		}
-	}
-	
-	if (array_num(pidTable) == 0) {
-		//array_cleanup(pidTable);
-		array_destroy(pidTable);
-		pidTable = NULL;
-	}
-	*/
-	/*
-	 * We don't take p_lock in here because we must have the only
-	 * reference to this structure. (Otherwise it would be
-	 * incorrect to destroy it.)
-	 */
-	/* VFS fields */
-	if (proc->p_cwd) {
-		VOP_DECREF(proc->p_cwd);
-		proc->p_cwd = NULL;
-	}
-#ifndef UW  // in the UW version, space destruction occurs in sys_exit, not here
-	if (proc->p_addrspace) {
-		/*
-		 * In case p is the currently running process (which
-		 * it might be in some circumstances, or if this code
-		 * gets moved into exit as suggested above), clear
-		 * p_addrspace before calling as_destroy. Otherwise if
-		 * as_destroy sleeps (which is quite possible) when we
-		 * come back we'll be calling as_activate on a
-		 * half-destroyed address space. This tends to be
-		 * messily fatal.
-		 */
-		struct addrspace *as;
-		as_deactivate();
-		as = curproc_setas(NULL);
-		as_destroy(as);
-	}
-#endif // UW
-#ifdef UW
-	if (proc->console) {
-	  vfs_close(proc->console);
-	}
-#endif // UW
-	threadarray_cleanup(&proc->p_threads);
-	spinlock_cleanup(&proc->p_lock);
-	kfree(proc->p_name);
-	kfree(proc);
-#ifdef UW
-	/* decrement the process count */
-        /* note: kproc is not included in the process count, but proc_destroy
-	   is never called on kproc (see KASSERT above), so we're OK to decrement
-	   the proc_count unconditionally here */
-	P(proc_count_mutex); 
-	KASSERT(proc_count > 0);
-	proc_count--;
-	/* signal the kernel menu thread if the process count has reached zero */
-	if (proc_count == 0) {
-	  V(no_proc_sem);
-	}
-	V(proc_count_mutex);
-#endif // UW
-	
-}
-/*
- * Create the process structure for the kernel.
- */
-void
-proc_bootstrap(void)
-{
-  kproc = proc_create("[kernel]");
-  if (kproc == NULL) {
-    panic("proc_create for kproc failed\n");
-  }
-#ifdef UW
-  proc_count = 0;
-  proc_count_mutex = sem_create("proc_count_mutex",1);
-  if (proc_count_mutex == NULL) {
-    panic("could not create proc_count_mutex semaphore\n");
-  }
-  no_proc_sem = sem_create("no_proc_sem",0);
-  if (no_proc_sem == NULL) {
-    panic("could not create no_proc_sem semaphore\n");
-  }
-#endif // UW 
-#if OPT_A2
-  pidTableLock = lock_create("pid_table_lock");
-  pidLock = lock_create("pid_lock");
-  waitTableCV = cv_create("wait_table_cv");
-  if(pidTableLock == NULL) {
-	  panic("could not create pid_table_lock");
-  }
-  if (pidLock == NULL) {
-	  panic("could not create pid_lock");
-  }
-  if (waitTableCV == NULL) {
-	  panic("could not create wait_table_cv");
-  } 
-  pidTable = array_create();
-  array_init(pidTable);
-  reusePIDList = array_create();
-  array_init(reusePIDList);
-#endif /* OPT_A2 */
-}
-/*
- * Create a fresh proc for use by runprogram.
- *
- * It will have no address space and will inherit the current
- * process's (that is, the kernel menu's) current directory.
- */
-struct proc *
-proc_create_runprogram(const char *name)
-{
-	struct proc *proc;
-	char *console_path;
-	proc = proc_create(name);
-	if (proc == NULL) {
-		return NULL;
-	}
-#if OPT_A2
-	struct pidTableEntry *entry = kmalloc(sizeof(struct pidTableEntry));
-	lock_acquire(pidLock);
-	proc->pid = createPID();
-	lock_release(pidLock);
-	entry->pid = proc->pid;
-	entry->state = ALIVE;
-	entry->parentPid = NO_PARENT;
-	entry->exitStatus = 0;
-	entry->children = array_create();
-	lock_acquire(pidTableLock);
-	array_add(pidTable, entry, NULL);
-	lock_release(pidTableLock);
-#endif /* OPT_A2 */
-#ifdef UW
-	/* open the console - this should always succeed */
-	console_path = kstrdup("con:");
-	if (console_path == NULL) {
-	  panic("unable to copy console path name during process creation\n");
-	}
-	if (vfs_open(console_path,O_WRONLY,0,&(proc->console))) {
-	  panic("unable to open the console during process creation\n");
-	}
-	kfree(console_path);
-#endif // UW
-	  
-	/* VM fields */
-	proc->p_addrspace = NULL;
-	/* VFS fields */
-#ifdef UW
-	/* we do not need to acquire the p_lock here, the running thread should
-           have the only reference to this process */
-        /* also, acquiring the p_lock is problematic because VOP_INCREF may block */
-	if (curproc->p_cwd != NULL) {
-		VOP_INCREF(curproc->p_cwd);
-		proc->p_cwd = curproc->p_cwd;
-	}
-#else // UW
-	spinlock_acquire(&curproc->p_lock);
-	if (curproc->p_cwd != NULL) {
-		VOP_INCREF(curproc->p_cwd);
-		proc->p_cwd = curproc->p_cwd;
-	}
-	spinlock_release(&curproc->p_lock);
-#endif // UW
-#ifdef UW
-	/* increment the count of processes */
-        /* we are assuming that all procs, including those created by fork(),
-           are created using a call to proc_create_runprogram  */
-	P(proc_count_mutex); 
-	proc_count++;
-	V(proc_count_mutex);
-#endif // UW
-	return proc;
-}
-/*
- * Add a thread to a process. Either the thread or the process might
- * or might not be current.
- */
-int
-proc_addthread(struct proc *proc, struct thread *t)
-{
-	int result;
-	KASSERT(t->t_proc == NULL);
-	spinlock_acquire(&proc->p_lock);
-	result = threadarray_add(&proc->p_threads, t, NULL);
-	spinlock_release(&proc->p_lock);
-	if (result) {
-		return result;
-	}
-	t->t_proc = proc;
-	return 0;
-}
-/*
- * Remove a thread from its process. Either the thread or the process
- * might or might not be current.
- */
-void
-proc_remthread(struct thread *t)
-{
-	struct proc *proc;
-	unsigned i, num;
-	proc = t->t_proc;
-	KASSERT(proc != NULL);
-	spinlock_acquire(&proc->p_lock);
-	/* ugh: find the thread in the array */
-	num = threadarray_num(&proc->p_threads);
-	for (i=0; i<num; i++) {
-		if (threadarray_get(&proc->p_threads, i) == t) {
-			threadarray_remove(&proc->p_threads, i);
-			spinlock_release(&proc->p_lock);
-			t->t_proc = NULL;
-			return;
-		}
-	}
-	/* Did not find it. */
-	spinlock_release(&proc->p_lock);
-	panic("Thread (%p) has escaped from its process (%p)\n", t, proc);
-}
-/*
- * Fetch the address space of the current process. Caution: it isn't
- * refcounted. If you implement multithreaded processes, make sure to
- * set up a refcount scheme or some other method to make this safe.
- */
-struct addrspace *
-curproc_getas(void)
-{
-	struct addrspace *as;
-#ifdef UW
-        /* Until user processes are created, threads used in testing 
-         * (i.e., kernel threads) have no process or address space.
-         */
-	if (curproc == NULL) {
-		return NULL;
-	}
-#endif
-	spinlock_acquire(&curproc->p_lock);
-	as = curproc->p_addrspace;
-	spinlock_release(&curproc->p_lock);
-	return as;
-}
-/*
- * Change the address space of the current process, and return the old
- * one.
- */
-struct addrspace *
-curproc_setas(struct addrspace *newas)
-{
-	struct addrspace *oldas;
-	struct proc *proc = curproc;
-	spinlock_acquire(&proc->p_lock);
-	oldas = proc->p_addrspace;
-	proc->p_addrspace = newas;
-	spinlock_release(&proc->p_lock);
-	return oldas;
+/*
+ * Copyright (c) 2013
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/*
+ * Process support.
+ *
+ * There is (intentionally) not much here; you will need to add stuff
+ * and maybe change around what's already present.
+ *
+ * p_lock is intended to be held when manipulating the pointers in the
+ * proc structure, not while doing any significant work with the
+ * things they point to. Rearrange this (and/or change it to be a
+ * regular lock) as needed.
+ *
+ * Unless you're implementing multithreaded user processes, the only
+ * process that will have more than one thread is the kernel process.
+ */
+#include "opt-A2.h"
+#include <types.h>
+#include <proc.h>
+#include <current.h>
+#include <addrspace.h>
+#include <vnode.h>
+#include <vfs.h>
+#include <synch.h>
+#include <kern/errno.h>
+#include <kern/fcntl.h>
+#include <kern/wait.h>
+#include <limits.h>
+#include <array.h>
+#include <conbuf.h>
+#include <klog.h>
+/*
+ * The process for the kernel; this holds all the kernel-only threads.
+ */
+struct proc *kproc;
+/*
+ * Mechanism for making the kernel menu thread sleep while processes are running
+ */
+#ifdef UW
+/* count of the number of processes, excluding kproc */
+static volatile unsigned int proc_count;
+/* provides mutual exclusion for proc_count */
+/* it would be better to use a lock here, but we use a semaphore because locks are not implemented in the base kernel */ 
+static struct semaphore *proc_count_mutex;
+/* used to signal the kernel menu thread when there are no processes */
+struct semaphore *no_proc_sem;   
+#endif  // UW
+#if OPT_A2
+/*
+ * Caches of released proc structures and pid table entries, so the
+ * common fork/exit cycle reuses them instead of going to kmalloc.
+ * Entries keep their waitSem while cached.
+ */
+#define PROC_CACHE_MAX 16
+#define ENTRY_CACHE_MAX 16
+static struct spinlock proc_cache_lock = SPINLOCK_INITIALIZER;
+static struct proc *proc_cache[PROC_CACHE_MAX];
+static unsigned int proc_cache_num = 0;
+/* protected by pidTableLock */
+static struct pidTableEntry *entryCache[ENTRY_CACHE_MAX];
+static unsigned int entryCacheNum = 0;
+pid_t pid_min = PID_MIN;
+// Creates unique PID for each new process
+// Recycled PIDs are taken from the end of reusePIDList, which is O(1)
+// Caller must hold pidTableLock, which also protects reusePIDList
+pid_t createPID(void) {
+	unsigned int num = array_num(reusePIDList);
+	if (num != 0) {
+		pid_t p = ((pid_t) array_get(reusePIDList, num - 1));
+		array_remove(reusePIDList, num - 1);
+		return p;
+	}
+	return pid_min++;
+}
+// Give entry a PID and put it in its PID Table slot
+// Returns an error if the table could not grow
+// Caller must hold pidTableLock
+static int pidTableInsert(struct pidTableEntry *entry) {
+	pid_t pid = createPID();
+	unsigned int slot = pid - PID_MIN;
+	if (slot < array_num(pidTable)) {
+		// a recycled PID; its slot was cleared by releaseEntry
+		KASSERT(array_get(pidTable, slot) == NULL);
+		array_set(pidTable, slot, entry);
+	} else {
+		// a fresh PID always comes next after the last slot
+		KASSERT(slot == array_num(pidTable));
+		int result = array_add(pidTable, entry, NULL);
+		if (result) {
+			pid_min--;
+			return result;
+		}
+	}
+	entry->pid = pid;
+	return 0;
+}
+// Given a PID, returns entry in PID Table corresponding to it, O(1)
+// Caller must hold pidTableLock, for reading at least
+struct pidTableEntry *returnEntry(pid_t pid) {
+	if (pid < PID_MIN || (unsigned int)(pid - PID_MIN) >= array_num(pidTable)) {
+		return NULL;
+	}
+	return array_get(pidTable, pid - PID_MIN);
+}
+// Returns true if child is child of parent
+// Parent links live in the entry itself so this is a field comparison
+bool isChild(pid_t parent, struct pidTableEntry *child) {
+	KASSERT(child != NULL);
+	return child->parentPid == parent;
+}
+// Returns the first child of parent that has exited and not yet
+// been reaped, O(children)
+// Caller must hold pidTableLock, for reading at least
+struct pidTableEntry *exitedChild(struct pidTableEntry *parent) {
+	KASSERT(parent != NULL);
+	for (struct pidTableEntry *c = parent->firstChild; c != NULL; c = c->nextSibling) {
+		if (c->state == ZOMBIE) {
+			return c;
+		}
+	}
+	return NULL;
+}
+// Push child onto the front of parent's children list
+// The parent takes a reference on the child's entry for as long as
+// it is linked, so it can still be waited on after the child exits
+// Caller must hold pidTableLock
+void addChild(struct pidTableEntry *parent, struct pidTableEntry *child) {
+	KASSERT(parent != NULL && child != NULL);
+	KASSERT(child->parent == NULL);
+	child->refCount++;
+	child->parent = parent;
+	child->parentPid = parent->pid;
+	child->prevSibling = NULL;
+	child->nextSibling = parent->firstChild;
+	if (parent->firstChild != NULL) {
+		parent->firstChild->prevSibling = child;
+	}
+	parent->firstChild = child;
+}
+// Unlink child from its parent's children list, O(1), and drop the
+// parent's reference. child must not be used afterwards.
+// Caller must hold pidTableLock
+void removeChild(struct pidTableEntry *child) {
+	KASSERT(child != NULL);
+	if (child->parent == NULL) {
+		return;
+	}
+	if (child->prevSibling != NULL) {
+		child->prevSibling->nextSibling = child->nextSibling;
+	} else {
+		child->parent->firstChild = child->nextSibling;
+	}
+	if (child->nextSibling != NULL) {
+		child->nextSibling->prevSibling = child->prevSibling;
+	}
+	child->parent = NULL;
+	child->parentPid = NO_PARENT;
+	child->nextSibling = NULL;
+	child->prevSibling = NULL;
+	releaseEntry(child);
+}
+// Return an entry that is in no list or table to the cache, or free it
+// Caller must hold pidTableLock
+static void entryFree(struct pidTableEntry *entry) {
+	if (entryCacheNum < ENTRY_CACHE_MAX) {
+		// Nobody can be sleeping on waitSem now; drop any counts
+		// left over from children we reaped without sleeping
+		while (sem_tryP(entry->waitSem)) {
+			/* nothing */
+		}
+		entryCache[entryCacheNum++] = entry;
+		return;
+	}
+	sem_destroy(entry->waitSem);
+	kfree(entry);
+}
+// Drop one reference to entry. The process holds one until
+// proc_destroy and its parent holds one while the child is linked.
+// The last release removes entry from the PID Table, frees it and
+// recycles its PID.
+// Caller must hold pidTableLock
+void releaseEntry(struct pidTableEntry *entry) {
+	KASSERT(entry != NULL);
+	KASSERT(entry->refCount > 0);
+	entry->refCount--;
+	if (entry->refCount > 0) {
+		return;
+	}
+	KASSERT(entry->parent == NULL);
+	KASSERT(entry->firstChild == NULL);
+	KASSERT(returnEntry(entry->pid) == entry);
+	array_set(pidTable, entry->pid - PID_MIN, NULL);
+	array_add(reusePIDList, (void *) entry->pid, NULL);
+	entryFree(entry);
+}
+// Get a pidTableEntry, with its waitSem, from the cache or the heap
+static struct pidTableEntry *entryAlloc(void) {
+	struct pidTableEntry *entry = NULL;
+	rwlock_acquire_write(pidTableLock);
+	if (entryCacheNum > 0) {
+		entry = entryCache[--entryCacheNum];
+	}
+	rwlock_release_write(pidTableLock);
+	if (entry != NULL) {
+		return entry;
+	}
+	entry = kmalloc(sizeof(struct pidTableEntry));
+	if (entry == NULL) {
+		return NULL;
+	}
+	entry->waitSem = sem_create("wait_sem", 0);
+	if (entry->waitSem == NULL) {
+		kfree(entry);
+		return NULL;
+	}
+	return entry;
+}
+// If proc is a vfork child still running in its parent's address
+// space, stop borrowing it and wake the parent. Returns true if so,
+// in which case the caller must not destroy the address space.
+bool vforkRelease(struct proc *proc) {
+	struct semaphore *done = proc->vforkDone;
+	if (done == NULL) {
+		return false;
+	}
+	proc->vforkDone = NULL;
+	V(done);
+	return true;
+}
+// Records that proc has exited with status, already encoded with
+// _MKWAIT_*. If it has a parent, it becomes a zombie holding status
+// and the parent is woken. Otherwise nobody can wait for it, and its
+// entry and PID are released in proc_destroy.
+void procExit(struct proc *proc, int status) {
+	rwlock_acquire_write(pidTableLock);
+	struct pidTableEntry *entry = proc->pidEntry;
+	if (entry->parentPid != NO_PARENT) {
+		// it has information that parent might need hence zombie
+		entry->state = ZOMBIE;
+		entry->exitStatus = status;
+		// wake only our parent, if it is waiting on us
+		V(entry->parent->waitSem);
+	} else {
+		entry->state = DEAD;
+	}
+	rwlock_release_write(pidTableLock);
+}
+// Waits for parent's child pid, or any child for WAIT_ANY, to exit
+// and reaps it. On success *reapedPid and *status are the child's PID
+// and exit status; with WNOHANG *reapedPid is 0 if no child has
+// exited yet.
+int procWait(struct proc *parent, pid_t pid, int options,
+	     pid_t *reapedPid, int *status) {
+	struct pidTableEntry *self = parent->pidEntry;
+	struct pidTableEntry *waitForMe = NULL;
+	struct pidTableEntry *reaped;
+	int result = 0;
+	rwlock_acquire_read(pidTableLock);
+	if (pid == WAIT_ANY && self->firstChild == NULL) {
+		// waiting for any child, but there are none
+		result = ECHILD;
+	} else if (pid != WAIT_ANY && (waitForMe = returnEntry(pid)) == NULL) {
+		// process does not exist
+		result = ESRCH;
+	} else if (pid != WAIT_ANY && !isChild(parent->pid, waitForMe)) {
+		// not our child
+		result = ECHILD;
+	} else if ((options & ~WNOHANG) != 0) {
+		result = EINVAL;
+	}
+	if (result) {
+		rwlock_release_read(pidTableLock);
+		return result;
+	}
+	// Each child exit V's our waitSem, so sleep on it until a child
+	// we are interested in has exited. A wakeup for some other child
+	// (or a count left over from one we reaped without sleeping) just
+	// means we look again. Only we can unlink our children, so
+	// waitForMe stays valid while we sleep unlocked. Looking only
+	// needs the read lock, so waits don't serialize each other.
+	while (1) {
+		if (pid == WAIT_ANY) {
+			reaped = exitedChild(self);
+		} else {
+			reaped = (waitForMe->state == ALIVE) ? NULL : waitForMe;
+		}
+		if (reaped != NULL || (options & WNOHANG)) {
+			break;
+		}
+		rwlock_release_read(pidTableLock);
+		P(self->waitSem);
+		rwlock_acquire_read(pidTableLock);
+	}
+	if (reaped == NULL) {
+		// WNOHANG and no child has exited yet
+		rwlock_release_read(pidTableLock);
+		*reapedPid = 0;
+		return 0;
+	}
+	// Reaping unlinks the child, which needs the write lock. Only
+	// we can unlink our children, so reaped is still ours if the
+	// upgrade has to drop our read hold and go the long way round.
+	if (!rwlock_upgrade(pidTableLock)) {
+		rwlock_acquire_write(pidTableLock);
+	}
+	// take the exit status and reap the child, dropping our
+	// reference to its entry
+	*reapedPid = reaped->pid;
+	*status = reaped->exitStatus;
+	removeChild(reaped);
+	rwlock_release_write(pidTableLock);
+	return 0;
+}
+#endif /* OPT_A2 */
+#if OPT_A2
+/*
+ * Get a proc structure from the cache, or the heap if it is empty.
+ */
+static
+struct proc *
+proc_cache_get(void)
+{
+	struct proc *proc = NULL;
+	spinlock_acquire(&proc_cache_lock);
+	if (proc_cache_num > 0) {
+		proc = proc_cache[--proc_cache_num];
+	}
+	spinlock_release(&proc_cache_lock);
+	if (proc == NULL) {
+		proc = kmalloc(sizeof(*proc));
+	}
+	return proc;
+}
+/*
+ * Return a proc structure to the cache, or the heap if it is full.
+ */
+static
+void
+proc_cache_put(struct proc *proc)
+{
+	spinlock_acquire(&proc_cache_lock);
+	if (proc_cache_num < PROC_CACHE_MAX) {
+		proc_cache[proc_cache_num++] = proc;
+		proc = NULL;
+	}
+	spinlock_release(&proc_cache_lock);
+	if (proc != NULL) {
+		kfree(proc);
+	}
+}
+/*
+ * Set the name of a proc, inline if it is short enough.
+ */
+static
+char *
+proc_setname(struct proc *proc, const char *name)
+{
+	if (strlen(name) < sizeof(proc->p_namebuf)) {
+		strcpy(proc->p_namebuf, name);
+		return proc->p_namebuf;
+	}
+	return kstrdup(name);
+}
+static
+void
+proc_freename(struct proc *proc)
+{
+	if (proc->p_name != proc->p_namebuf) {
+		kfree(proc->p_name);
+	}
+}
+#endif /* OPT_A2 */
+/*
+ * Create a proc structure.
+ */
+static
+struct proc *
+proc_create(const char *name)
+{
+	struct proc *proc;
+#if OPT_A2
+	proc = proc_cache_get();
+#else
+	proc = kmalloc(sizeof(*proc));
+#endif /* OPT_A2 */
+	if (proc == NULL) {
+		return NULL;
+	}
+#if OPT_A2
+	proc->p_name = proc_setname(proc, name);
+	if (proc->p_name == NULL) {
+		proc_cache_put(proc);
+		return NULL;
+	}
+#else
+	proc->p_name = kstrdup(name);
+	if (proc->p_name == NULL) {
+		kfree(proc);
+		return NULL;
+	}
+#endif /* OPT_A2 */
+	threadarray_init(&proc->p_threads);
+	spinlock_init(&proc->p_lock);
+	/* VM fields */
+	proc->p_addrspace = NULL;
+	/* VFS fields */
+	proc->p_cwd = NULL;
+#ifdef UW
+	proc->console = NULL;
+#endif // UW
+#if OPT_A2
+	seqlock_init(&proc->p_asseq);
+	proc->pidEntry = NULL;
+	proc->vforkDone = NULL;
+#endif /* OPT_A2 */
+	return proc;
+}
+#if OPT_A2
+/*
+ * Undo proc_create for a proc that failed setup before it was
+ * given a pid or counted in proc_count.
+ */
+static
+void
+proc_free(struct proc *proc)
+{
+	threadarray_cleanup(&proc->p_threads);
+	spinlock_cleanup(&proc->p_lock);
+	seqlock_cleanup(&proc->p_asseq);
+	proc_freename(proc);
+	proc_cache_put(proc);
+}
+#endif /* OPT_A2 */
+/*
+ * Destroy a proc structure.
+ */
+void
+proc_destroy(struct proc *proc)
+{
+	/*
+         * note: some parts of the process structure, such as the address space,
+         *  are destroyed in sys_exit, before we get here
+         *
+         * note: depending on where this function is called from, curproc may not
+         * be defined because the calling thread may have already detached itself
+         * from the process.
+	 */
+	KASSERT(proc != NULL);
+	KASSERT(proc != kproc);
+#if OPT_A2
+	struct pidTableEntry *entry = proc->pidEntry;
+	if (entry != NULL) {
+		rwlock_acquire_write(pidTableLock);
+		// Orphan our children, dropping our reference to each;
+		// children that are already zombies are freed here
+		while (entry->firstChild != NULL) {
+			removeChild(entry->firstChild);
+		}
+		// Drop the process' own reference. If a parent may still
+		// wait on us the entry lives on until it is reaped
+		releaseEntry(entry);
+		rwlock_release_write(pidTableLock);
+		proc->pidEntry = NULL;
+	}
+#endif /* OPT_A2 */
+	/*
+	 * We don't take p_lock in here because we must have the only
+	 * reference to this structure. (Otherwise it would be
+	 * incorrect to destroy it.)
+	 */
+	/* VFS fields */
+	if (proc->p_cwd) {
+		VOP_DECREF(proc->p_cwd);
+		proc->p_cwd = NULL;
+	}
+#ifndef UW  // in the UW version, space destruction occurs in sys_exit, not here
+	if (proc->p_addrspace) {
+		/*
+		 * In case p is the currently running process (which
+		 * it might be in some circumstances, or if this code
+		 * gets moved into exit as suggested above), clear
+		 * p_addrspace before calling as_destroy. Otherwise if
+		 * as_destroy sleeps (which is quite possible) when we
+		 * come back we'll be calling as_activate on a
+		 * half-destroyed address space. This tends to be
+		 * messily fatal.
+		 */
+		struct addrspace *as;
+		as_deactivate();
+		as = curproc_setas(NULL);
+		as_destroy(as);
+	}
+#endif // UW
+#ifdef UW
+	if (proc->console) {
+	  vfs_close(proc->console);
+	}
+#endif // UW
+	threadarray_cleanup(&proc->p_threads);
+	spinlock_cleanup(&proc->p_lock);
+#if OPT_A2
+	seqlock_cleanup(&proc->p_asseq);
+	proc_freename(proc);
+	proc_cache_put(proc);
+#else
+	kfree(proc->p_name);
+	kfree(proc);
+#endif /* OPT_A2 */
+#ifdef UW
+	/* decrement the process count */
+        /* note: kproc is not included in the process count, but proc_destroy
+	   is never called on kproc (see KASSERT above), so we're OK to decrement
+	   the proc_count unconditionally here */
+	P(proc_count_mutex); 
+	KASSERT(proc_count > 0);
+	proc_count--;
+	/* signal the kernel menu thread if the process count has reached zero */
+	if (proc_count == 0) {
+	  V(no_proc_sem);
+	}
+	V(proc_count_mutex);
+#endif // UW
+	
+}
+/*
+ * Create the process structure for the kernel.
+ */
+void
+proc_bootstrap(void)
+{
+  kproc = proc_create("[kernel]");
+  if (kproc == NULL) {
+    panic("proc_create for kproc failed\n");
+  }
+#ifdef UW
+  proc_count = 0;
+  proc_count_mutex = sem_create("proc_count_mutex",1);
+  if (proc_count_mutex == NULL) {
+    panic("could not create proc_count_mutex semaphore\n");
+  }
+  no_proc_sem = sem_create("no_proc_sem",0);
+  if (no_proc_sem == NULL) {
+    panic("could not create no_proc_sem semaphore\n");
+  }
+#endif // UW 
+#if OPT_A2
+  pidTableLock = rwlock_create("pid_table_lock");
+  if(pidTableLock == NULL) {
+	  panic("could not create pid_table_lock");
+  }
+  pidTable = array_create();
+  array_init(pidTable);
+  reusePIDList = array_create();
+  array_init(reusePIDList);
+  conbufBootstrap();
+  klogBootstrap();
+#endif /* OPT_A2 */
+}
+/*
+ * Create a fresh proc for use by runprogram.
+ *
+ * It will have no address space and will inherit the current
+ * process's (that is, the kernel menu's) current directory.
+ */
+struct proc *
+proc_create_runprogram(const char *name)
+{
+	struct proc *proc;
+#if !OPT_A2
+	char *console_path;
+#endif /* !OPT_A2 */
+	proc = proc_create(name);
+	if (proc == NULL) {
+		return NULL;
+	}
+#if OPT_A2
+	struct pidTableEntry *entry = entryAlloc();
+	if (entry == NULL) {
+		proc_free(proc);
+		return NULL;
+	}
+	entry->refCount = 1;
+	entry->state = ALIVE;
+	entry->parentPid = NO_PARENT;
+	entry->exitStatus = 0;
+	entry->parent = NULL;
+	entry->firstChild = NULL;
+	entry->nextSibling = NULL;
+	entry->prevSibling = NULL;
+	proc->pidEntry = entry;
+	rwlock_acquire_write(pidTableLock);
+	if (pidTableInsert(entry)) {
+		entryFree(entry);
+		rwlock_release_write(pidTableLock);
+		proc->pidEntry = NULL;
+		proc_free(proc);
+		return NULL;
+	}
+	proc->pid = entry->pid;
+	rwlock_release_write(pidTableLock);
+#endif /* OPT_A2 */
+#ifdef UW
+#if OPT_A2
+	/* every process shares one console vnode, opened the first time
+	   through; each holds a reference that vfs_close in proc_destroy
+	   drops again. proc_count_mutex serializes the first open, and
+	   the kernel log drainer is started along with the console. */
+	P(proc_count_mutex);
+	klogStart();
+	proc->console = conbufOpen();
+	/* nothing of ours is buffered yet */
+	proc->conWritten = false;
+	V(proc_count_mutex);
+#else
+	/* open the console - this should always succeed */
+	console_path = kstrdup("con:");
+	if (console_path == NULL) {
+	  panic("unable to copy console path name during process creation\n");
+	}
+	if (vfs_open(console_path,O_WRONLY,0,&(proc->console))) {
+	  panic("unable to open the console during process creation\n");
+	}
+	kfree(console_path);
+#endif /* OPT_A2 */
+#endif // UW
+	  
+	/* VM fields */
+	proc->p_addrspace = NULL;
+	/* VFS fields */
+#ifdef UW
+	/* we do not need to acquire the p_lock here, the running thread should
+           have the only reference to this process */
+        /* also, acquiring the p_lock is problematic because VOP_INCREF may block */
+	if (curproc->p_cwd != NULL) {
+		VOP_INCREF(curproc->p_cwd);
+		proc->p_cwd = curproc->p_cwd;
+	}
+#else // UW
+	spinlock_acquire(&curproc->p_lock);
+	if (curproc->p_cwd != NULL) {
+		VOP_INCREF(curproc->p_cwd);
+		proc->p_cwd = curproc->p_cwd;
+	}
+	spinlock_release(&curproc->p_lock);
+#endif // UW
+#ifdef UW
+	/* increment the count of processes */
+        /* we are assuming that all procs, including those created by fork(),
+           are created using a call to proc_create_runprogram  */
+	P(proc_count_mutex); 
+	proc_count++;
+	V(proc_count_mutex);
+#endif // UW
+	return proc;
+}
+/*
+ * Add a thread to a process. Either the thread or the process might
+ * or might not be current.
+ */
+int
+proc_addthread(struct proc *proc, struct thread *t)
+{
+	int result;
+	KASSERT(t->t_proc == NULL);
+	spinlock_acquire(&proc->p_lock);
+	result = threadarray_add(&proc->p_threads, t, NULL);
+	spinlock_release(&proc->p_lock);
+	if (result) {
+		return result;
+	}
+	t->t_proc = proc;
+	return 0;
+}
+/*
+ * Remove a thread from its process. Either the thread or the process
+ * might or might not be current.
+ */
+void
+proc_remthread(struct thread *t)
+{
+	struct proc *proc;
+	unsigned i, num;
+	proc = t->t_proc;
+	KASSERT(proc != NULL);
+	spinlock_acquire(&proc->p_lock);
+	/* ugh: find the thread in the array */
+	num = threadarray_num(&proc->p_threads);
+	for (i=0; i<num; i++) {
+		if (threadarray_get(&proc->p_threads, i) == t) {
+			threadarray_remove(&proc->p_threads, i);
+			spinlock_release(&proc->p_lock);
+			t->t_proc = NULL;
+			return;
+		}
+	}
+	/* Did not find it. */
+	spinlock_release(&proc->p_lock);
+	panic("Thread (%p) has escaped from its process (%p)\n", t, proc);
+}
+/*
+ * Fetch the address space of the current process. Caution: it isn't
+ * refcounted. If you implement multithreaded processes, make sure to
+ * set up a refcount scheme or some other method to make this safe.
+ */
+struct addrspace *
+curproc_getas(void)
+{
+	struct addrspace *as;
+#ifdef UW
+        /* Until user processes are created, threads used in testing 
+         * (i.e., kernel threads) have no process or address space.
+         */
+	if (curproc == NULL) {
+		return NULL;
+	}
+#endif
+#if OPT_A2
+	/* vm_fault calls this on every TLB miss, so take no lock */
+	struct proc *proc = curproc;
+	unsigned seq;
+	do {
+		seq = seqlock_read_begin(&proc->p_asseq);
+		as = proc->p_addrspace;
+	} while (seqlock_read_retry(&proc->p_asseq, seq));
+#else
+	spinlock_acquire(&curproc->p_lock);
+	as = curproc->p_addrspace;
+	spinlock_release(&curproc->p_lock);
+#endif /* OPT_A2 */
+	return as;
+}
+/*
+ * Change the address space of the current process, and return the old
+ * one.
+ */
+struct addrspace *
+curproc_setas(struct addrspace *newas)
+{
+	struct addrspace *oldas;
+	struct proc *proc = curproc;
+#if OPT_A2
+	seqlock_write_begin(&proc->p_asseq);
+	oldas = proc->p_addrspace;
+	proc->p_addrspace = newas;
+	seqlock_write_end(&proc->p_asseq);
+#else
+	spinlock_acquire(&proc->p_lock);
+	oldas = proc->p_addrspace;
+	proc->p_addrspace = newas;
+	spinlock_release(&proc->p_lock);
+#endif /* OPT_A2 */
+	return oldas;
 }
\ No newline at end of file
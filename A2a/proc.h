@@ -1,122 +1,169 @@
-/*
- * Copyright (c) 2013
- *	The President and Fellows of Harvard College.
- *
- * Redistribution and use in source and binary forms, with or without
- * modification, are permitted provided that the following conditions
- * are met:
- * 1. Redistributions of source code must retain the above copyright
- *    notice, this list of conditions and the following disclaimer.
- * 2. Redistributions in binary form must reproduce the above copyright
- *    notice, this list of conditions and the following disclaimer in the
- *    documentation and/or other materials provided with the distribution.
- * 3. Neither the name of the University nor the names of its contributors
- *    may be used to endorse or promote products derived from this software
- *    without specific prior written permission.
- *
- * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
- * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
- * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
- * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
- * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
- * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
- * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
- * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
- * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
- * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
- * SUCH DAMAGE.
- */
-#ifndef _PROC_H_
-#define _PROC_H_
-/*
- * Definition of a process.
- *
- * Note: curproc is defined by <current.h>.
- */
-#include "opt-A2.h"
-#include <spinlock.h>
-#include <thread.h> /* required for struct threadarray */
-#include <array.h>
-struct addrspace;
-struct vnode;
-#ifdef UW
-struct semaphore;
-#endif // UW
-#if OPT_A2
-// defining constants for states
-#define DEAD 0
-#define ALIVE 1
-#define ZOMBIE 2
-#define NO_PARENT -1
-// array of all processes
-struct array *pidTable;
-// List of PIDs we can reuse
-struct array *reusePIDList;
-// Protects PID Table
-struct lock *pidTableLock;
-struct cv *waitTableCV;
-struct lock *pidLock;
-// Each element in the pidTable is a pidTableEntry
-struct pidTableEntry {
-	pid_t pid;
-	pid_t parentPid;
-	struct array *children;
-	int state;
-	int exitStatus;
-};
-#endif /* OPT_A2 */
-/*
- * Process structure.
- */
-struct proc {
-	char *p_name;			/* Name of this process */
-	struct spinlock p_lock;		/* Lock for this structure */
-	struct threadarray p_threads;	/* Threads in this process */
-	/* VM */
-	struct addrspace *p_addrspace;	/* virtual address space */
-	/* VFS */
-	struct vnode *p_cwd;		/* current working directory */
-#ifdef UW
-  /* a vnode to refer to the console device */
-  /* this is a quick-and-dirty way to get console writes working */
-  /* you will probably need to change this when implementing file-related
-     system calls, since each process will need to keep track of all files
-     it has opened, not just the console. */
-  struct vnode *console;                /* a vnode for the console device */
-#endif
-	/* add more material here as needed */
-#if OPT_A2
-	pid_t pid;
-#endif /* OPT_A2 */
-};
-/* This is the process structure for the kernel and for kernel-only threads. */
-extern struct proc *kproc;
-/* Semaphore used to signal when there are no more processes */
-#ifdef UW
-extern struct semaphore *no_proc_sem;
-#endif // UW
-/* Call once during system startup to allocate data structures. */
-void proc_bootstrap(void);
-/* Create a fresh process for use by runprogram(). */
-struct proc *proc_create_runprogram(const char *name);
-/* Destroy a process. */
-void proc_destroy(struct proc *proc);
-/* Attach a thread to a process. Must not already have a process. */
-int proc_addthread(struct proc *proc, struct thread *t);
-/* Detach a thread from its process. */
-void proc_remthread(struct thread *t);
-/* Fetch the address space of the current process. */
-struct addrspace *curproc_getas(void);
-/* Change the address space of the current process, and return the old one. */
-struct addrspace *curproc_setas(struct addrspace *);
-#if OPT_A2
-// Generate unique PID for new process
-pid_t createPID(void);
-// returns true if child is a child of parent
-bool isChild(pid_t parent, pid_t child);
-// Returns pidTableEntry of given pid
-struct pidTableEntry *returnEntry(pid_t pid);
-// Removes pid entry from Pid Table
-void removeFromPidTable(pid_t pid);
-#endif /* OPT_A2 */
+/*
+ * Copyright (c) 2013
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef _PROC_H_
+#define _PROC_H_
+/*
+ * Definition of a process.
+ *
+ * Note: curproc is defined by <current.h>.
+ */
+#include "opt-A2.h"
+#include <spinlock.h>
+#include <thread.h> /* required for struct threadarray */
+#include <array.h>
+#if OPT_A2
+#include <synch.h> /* required for struct seqlock */
+#endif /* OPT_A2 */
+struct addrspace;
+struct vnode;
+#ifdef UW
+struct semaphore;
+#endif // UW
+#if OPT_A2
+// defining constants for states
+#define DEAD 0
+#define ALIVE 1
+#define ZOMBIE 2
+#define NO_PARENT -1
+// names shorter than this are kept inside struct proc
+#define PROC_NAME_INLINE 32
+// all processes, indexed by PID - PID_MIN; free slots are NULL
+struct array *pidTable;
+// List of PIDs we can reuse
+struct array *reusePIDList;
+// Protects PID Table, reusePIDList and every pidTableEntry.
+// Lookups (waitpid) take it for reading; anything that changes an
+// entry, a link or the table itself takes it for writing.
+struct rwlock *pidTableLock;
+// Each element in the pidTable is a pidTableEntry
+// Children of a process are kept on an intrusive doubly linked list
+// threaded through the entries themselves, so no lookups are needed
+// to walk or unlink them. All links are protected by pidTableLock.
+// waitSem is V'd each time one of this process' children exits, so
+// an exit wakes only its parent, which sleeps on it in waitpid
+// without holding pidTableLock.
+// refCount counts the process itself plus its parent while linked;
+// see releaseEntry.
+struct pidTableEntry {
+	pid_t pid;
+	pid_t parentPid;
+	struct pidTableEntry *parent;
+	struct pidTableEntry *firstChild;
+	struct pidTableEntry *nextSibling;
+	struct pidTableEntry *prevSibling;
+	struct semaphore *waitSem;
+	unsigned int refCount;
+	int state;
+	int exitStatus;
+};
+#endif /* OPT_A2 */
+/*
+ * Process structure.
+ */
+struct proc {
+	char *p_name;			/* Name of this process */
+#if OPT_A2
+	char p_namebuf[PROC_NAME_INLINE];	/* p_name, if it fits */
+#endif /* OPT_A2 */
+	struct spinlock p_lock;		/* Lock for this structure */
+	struct threadarray p_threads;	/* Threads in this process */
+	/* VM */
+	struct addrspace *p_addrspace;	/* virtual address space */
+#if OPT_A2
+	struct seqlock p_asseq;		/* writers of p_addrspace */
+#endif /* OPT_A2 */
+	/* VFS */
+	struct vnode *p_cwd;		/* current working directory */
+#ifdef UW
+  /* a vnode to refer to the console device */
+  /* this is a quick-and-dirty way to get console writes working */
+  /* you will probably need to change this when implementing file-related
+     system calls, since each process will need to keep track of all files
+     it has opened, not just the console. */
+  struct vnode *console;                /* a vnode for the console device */
+#endif
+	/* add more material here as needed */
+#if OPT_A2
+	pid_t pid;
+	struct pidTableEntry *pidEntry;	/* this process' entry in pidTable */
+	/* set while a vfork child borrows its parent's address space;
+	   V'd to resume the parent when the child execs or exits */
+	struct semaphore *vforkDone;
+	/* console buffer position just past this process' last write,
+	   valid once conWritten is set */
+	unsigned int conMark;
+	bool conWritten;
+#endif /* OPT_A2 */
+};
+/* This is the process structure for the kernel and for kernel-only threads. */
+extern struct proc *kproc;
+/* Semaphore used to signal when there are no more processes */
+#ifdef UW
+extern struct semaphore *no_proc_sem;
+#endif // UW
+/* Call once during system startup to allocate data structures. */
+void proc_bootstrap(void);
+/* Create a fresh process for use by runprogram(). */
+struct proc *proc_create_runprogram(const char *name);
+/* Destroy a process. */
+void proc_destroy(struct proc *proc);
+/* Attach a thread to a process. Must not already have a process. */
+int proc_addthread(struct proc *proc, struct thread *t);
+/* Detach a thread from its process. */
+void proc_remthread(struct thread *t);
+/* Fetch the address space of the current process. */
+struct addrspace *curproc_getas(void);
+/* Change the address space of the current process, and return the old one. */
+struct addrspace *curproc_setas(struct addrspace *);
+#if OPT_A2
+// Generate unique PID for new process
+pid_t createPID(void);
+// returns true if child is a child of parent
+bool isChild(pid_t parent, struct pidTableEntry *child);
+// Returns an exited child of parent waiting to be reaped, or NULL
+struct pidTableEntry *exitedChild(struct pidTableEntry *parent);
+// Links child onto parent's list of children
+void addChild(struct pidTableEntry *parent, struct pidTableEntry *child);
+// Unlinks child from its parent's list of children and drops the
+// parent's reference to it
+void removeChild(struct pidTableEntry *child);
+// Returns pidTableEntry of given pid
+struct pidTableEntry *returnEntry(pid_t pid);
+// Hands a borrowed address space back to a vfork parent and resumes it.
+// Returns false if proc owns its address space.
+bool vforkRelease(struct proc *proc);
+// Drops a reference to entry, freeing it and its PID on the last one
+void releaseEntry(struct pidTableEntry *entry);
+// The PID table side of _exit: status is already _MKWAIT_* encoded
+void procExit(struct proc *proc, int status);
+// The PID table side of waitpid: waits for and reaps a child of parent
+int procWait(struct proc *parent, pid_t pid, int options,
+	     pid_t *reapedPid, int *status);
+#endif /* OPT_A2 */
 #endif /* _PROC_H_ */
\ No newline at end of file
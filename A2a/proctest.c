@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/*
+ * Process lifecycle tests. These drive the proc, PID table and
+ * waitSem bookkeeping that sys_fork, sys__exit and sys_waitpid use
+ * (addChild, procExit and procWait), from kernel threads, without
+ * running any user code.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <kern/wait.h>
+#include <lib.h>
+#include <clock.h>
+#include <thread.h>
+#include <synch.h>
+#include <proc.h>
+#include <current.h>
+#include <addrspace.h>
+#include <vm.h>
+#include <test.h>
+#include "opt-A2.h"
+#include "opt-A3.h"
+#if OPT_A2
+#define SOAK_THREADS 4
+#define SOAK_CHILDREN 4		/* children per parent per round */
+#define SOAK_ROUNDS 2000	/* default rounds per thread */
+#define SOAK_WARMUP 50		/* rounds before the baseline is taken */
+#define SOAK_SLACK 2		/* frames the heap may still grow by */
+#define BENCH_CYCLES 10000	/* default cycles to time */
+static struct semaphore *soakDone;
+// Make a new child of parent, linked as sys_fork links it
+static struct proc *soakFork(struct proc *parent) {
+	struct proc *child = proc_create_runprogram("soak_child");
+	if (child == NULL) {
+		return NULL;
+	}
+	rwlock_acquire_write(pidTableLock);
+	addChild(parent->pidEntry, child->pidEntry);
+	rwlock_release_write(pidTableLock);
+	return child;
+}
+// Exit child through sys__exit's procExit, leaving a zombie for its
+// parent
+static void soakExit(struct proc *child, int code) {
+	procExit(child, _MKWAIT_EXIT(code));
+	proc_destroy(child);
+}
+// Reap child pid of parent through sys_waitpid's procWait
+// Returns its exit status, or -1 on error
+static int soakWait(struct proc *parent, pid_t pid) {
+	pid_t reaped;
+	int status;
+	if (procWait(parent, pid, 0, &reaped, &status) || reaped != pid) {
+		return -1;
+	}
+	return status;
+}
+// One parent with SOAK_CHILDREN children that all exit. Half are
+// reaped by the parent; the rest are still zombies when the parent
+// goes away and are freed by its proc_destroy.
+static int soakRound(void) {
+	struct proc *parent, *child;
+	pid_t pids[SOAK_CHILDREN];
+	int result = 0;
+	int n;
+	parent = proc_create_runprogram("soak_parent");
+	if (parent == NULL) {
+		return ENOMEM;
+	}
+	for (n = 0; n < SOAK_CHILDREN; n++) {
+		child = soakFork(parent);
+		if (child == NULL) {
+			result = ENOMEM;
+			break;
+		}
+		pids[n] = child->pid;
+		soakExit(child, n);
+	}
+	for (int i = 0; i < n / 2; i++) {
+		if (soakWait(parent, pids[i]) != _MKWAIT_EXIT(i)) {
+			result = EINVAL;
+		}
+	}
+	proc_destroy(parent);
+	return result;
+}
+static void soakThread(void *data, unsigned long rounds) {
+	int *result = data;
+	for (unsigned long r = 0; r < rounds && *result == 0; r++) {
+		*result = soakRound();
+	}
+	V(soakDone);
+}
+// pt1 [rounds]: fork/exit soak test. Runs SOAK_THREADS threads of
+// parents and children through fork, exit and waitpid, and checks
+// that the kernel heap does not grow once the caches are warm. The
+// heap is counted in coremap frames, as nothing here has an address
+// space; without OPT_A3 there is no coremap and that check is skipped.
+int forksoak(int nargs, char **args) {
+	unsigned long rounds = SOAK_ROUNDS;
+	int result[SOAK_THREADS];
+#if OPT_A3
+	unsigned int before, after;
+#endif /* OPT_A3 */
+	int started = 0;
+	bool ok = true;
+	if (nargs > 1) {
+		rounds = atoi(args[1]);
+	}
+	soakDone = sem_create("soak_done", 0);
+	if (soakDone == NULL) {
+		return ENOMEM;
+	}
+	// Keep one process alive throughout, so that proc_count does
+	// not drop to 0 (and wake the menu) at the end of every round
+	struct proc *anchor = proc_create_runprogram("forksoak");
+	if (anchor == NULL) {
+		sem_destroy(soakDone);
+		return ENOMEM;
+	}
+	for (int r = 0; r < SOAK_WARMUP; r++) {
+		if (soakRound()) {
+			ok = false;
+		}
+	}
+#if OPT_A3
+	before = coremap_used();
+#endif /* OPT_A3 */
+	for (int i = 0; i < SOAK_THREADS; i++) {
+		result[i] = 0;
+		if (thread_fork("forksoak", NULL, soakThread, &result[i], rounds)) {
+			kprintf("forksoak: thread_fork failed\n");
+			ok = false;
+			break;
+		}
+		started++;
+	}
+	for (int i = 0; i < started; i++) {
+		P(soakDone);
+	}
+#if OPT_A3
+	after = coremap_used();
+#endif /* OPT_A3 */
+	for (int i = 0; i < started; i++) {
+		if (result[i]) {
+			kprintf("forksoak: thread %d: %s\n", i, strerror(result[i]));
+			ok = false;
+		}
+	}
+	proc_destroy(anchor);
+#ifdef UW
+	// proc_destroy V'd no_proc_sem if that was the last process;
+	// nobody is waiting for it
+	sem_tryP(no_proc_sem);
+#endif // UW
+	sem_destroy(soakDone);
+#if OPT_A3
+	kprintf("forksoak: %d threads x %lu rounds, %u frames in use "
+		"before, %u after\n", started, rounds, before, after);
+	if (after > before + SOAK_SLACK) {
+		kprintf("forksoak: kernel heap grew by %u frames\n",
+			after - before);
+		ok = false;
+	}
+#else
+	kprintf("forksoak: %d threads x %lu rounds; no coremap, kernel "
+		"heap check skipped\n", started, rounds);
+#endif /* OPT_A3 */
+	kprintf("forksoak: %s\n", ok ? "passed" : "FAILED");
+	return 0;
+}
+// pt2 [cycles]: proc/PID entry micro-benchmark. Times the proc and
+// PID entry side of a fork/exit/waitpid cycle - creating the proc and
+// its entry, linking it to its parent, procExit and procWait - which
+// is what the proc and entry caches speed up. It is not a fork
+// benchmark: it has no address space copy, thread, kernel stack or
+// trapframe, so it says nothing about what a whole fork costs.
+int procbench(int nargs, char **args) {
+	unsigned long cycles = BENCH_CYCLES;
+	time_t beforesecs, aftersecs, secs;
+	uint32_t beforensecs, afternsecs, nsecs;
+	struct proc *parent, *child;
+	unsigned long i;
+	int result = 0;
+	if (nargs > 1) {
+		cycles = atoi(args[1]);
+	}
+	if (cycles == 0) {
+		return EINVAL;
+	}
+	parent = proc_create_runprogram("procbench");
+	if (parent == NULL) {
+		return ENOMEM;
+	}
+	gettime(&beforesecs, &beforensecs);
+	for (i = 0; i < cycles; i++) {
+		child = soakFork(parent);
+		if (child == NULL) {
+			result = ENOMEM;
+			break;
+		}
+		pid_t pid = child->pid;
+		soakExit(child, 0);
+		if (soakWait(parent, pid) != _MKWAIT_EXIT(0)) {
+			result = EINVAL;
+			break;
+		}
+	}
+	gettime(&aftersecs, &afternsecs);
+	proc_destroy(parent);
+#ifdef UW
+	sem_tryP(no_proc_sem);
+#endif // UW
+	if (result) {
+		kprintf("procbench: failed after %lu cycles: %s\n", i,
+			strerror(result));
+		return result;
+	}
+	getinterval(beforesecs, beforensecs, aftersecs, afternsecs,
+		    &secs, &nsecs);
+	uint64_t ns = (uint64_t)secs * 1000000000 + nsecs;
+	kprintf("procbench: %lu cycles in %lu.%09lu seconds, %lu ns each\n",
+		cycles, (unsigned long) secs, (unsigned long) nsecs,
+		(unsigned long) (ns / cycles));
+	return 0;
+}
+#if OPT_A3
+#define KDATA_PROGRAM "/bin/true"	/* default program for pt3 */
+static struct semaphore *kdataDone;
+static char *kdataProgram;
+static int kdataResult;
+// In a fresh process, load kdataProgram the way runprogram, execv and
+// spawn do, then check its kernel data page without running it
+static void kdataThread(void *unused1, unsigned long unused2) {
+	struct arg_arena *arena;
+	struct addrspace *as;
+	volatile struct kdata_page *kd;
+	vaddr_t entrypoint, stackptr;
+	int result;
+	(void)unused1;
+	(void)unused2;
+	arena = arg_arena_get();
+	if (arena == NULL) {
+		result = ENOMEM;
+	} else {
+		result = arg_arena_setargs(arena, kdataProgram, &kdataProgram, 1);
+		if (result == 0) {
+			result = loadprogram(arg_arena_path(arena), arena,
+					     &entrypoint, &stackptr);
+		}
+		arg_arena_put(arena);
+	}
+	as = curproc_getas();
+	if (result == 0) {
+		kd = (volatile struct kdata_page *)
+			PADDR_TO_KVADDR(as->as_kdatapbase);
+		if (kd->kd_pid != curproc->pid) {
+			kprintf("kdatatest: page says pid %d, process is %d\n",
+				(int)kd->kd_pid, (int)curproc->pid);
+			result = EINVAL;
+		}
+		if (kd->kd_sec == 0 && kd->kd_nsec == 0) {
+			kprintf("kdatatest: page has no time\n");
+			result = EINVAL;
+		}
+	}
+	// tear down as sys__exit does, without entering user mode
+	if (as != NULL) {
+		as_deactivate();
+		as = curproc_setas(NULL);
+		as_destroy(as);
+	}
+	kdataResult = result;
+	proc_remthread(curthread);
+	V(kdataDone);
+	thread_exit();
+}
+// pt3 [program]: check that a freshly loaded process' kernel data
+// page already holds its own pid and the time, before its first
+// context switch or clock tick
+int kdatatest(int nargs, char **args) {
+	struct proc *proc;
+	kdataProgram = (nargs > 1) ? args[1] : KDATA_PROGRAM;
+	kdataDone = sem_create("kdata_done", 0);
+	if (kdataDone == NULL) {
+		return ENOMEM;
+	}
+	proc = proc_create_runprogram("kdatatest");
+	if (proc == NULL) {
+		sem_destroy(kdataDone);
+		return ENOMEM;
+	}
+	kdataResult = 0;
+	if (thread_fork("kdatatest", proc, kdataThread, NULL, 0)) {
+		kdataResult = ENOMEM;
+	} else {
+		P(kdataDone);
+	}
+	proc_destroy(proc);
+#ifdef UW
+	sem_tryP(no_proc_sem);
+#endif // UW
+	sem_destroy(kdataDone);
+	if (kdataResult) {
+		kprintf("kdatatest: %s: %s\n", kdataProgram,
+			strerror(kdataResult));
+	}
+	kprintf("kdatatest: %s\n", kdataResult ? "FAILED" : "passed");
+	return 0;
+}
+#endif /* OPT_A3 */
+#endif /* OPT_A2 */
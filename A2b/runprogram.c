@@ -1,136 +1,500 @@
-/*
- * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
- *	The President and Fellows of Harvard College.
- *
- * Redistribution and use in source and binary forms, with or without
- * modification, are permitted provided that the following conditions
- * are met:
- * 1. Redistributions of source code must retain the above copyright
- *    notice, this list of conditions and the following disclaimer.
- * 2. Redistributions in binary form must reproduce the above copyright
- *    notice, this list of conditions and the following disclaimer in the
- *    documentation and/or other materials provided with the distribution.
- * 3. Neither the name of the University nor the names of its contributors
- *    may be used to endorse or promote products derived from this software
- *    without specific prior written permission.
- *
- * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
- * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
- * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
- * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
- * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
- * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
- * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
- * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
- * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
- * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
- * SUCH DAMAGE.
- */
-/*
- * Sample/test code for running a user program.  You can use this for
- * reference when implementing the execv() system call. Remember though
- * that execv() needs to do more than this function does.
- */
-#include <types.h>
-#include <kern/errno.h>
-#include <kern/fcntl.h>
-#include <lib.h>
-#include <proc.h>
-#include <current.h>
-#include <addrspace.h>
-#include <vm.h>
-#include <vfs.h>
-#include <syscall.h>
-#include <test.h>
-#include <limits.h>
-#include <mips/trapframe.h>
-#include "opt-A2.h"
-#include <vfs.h>
-#include <kern/fcntl.h>
-#include <copyinout.h>
-/*
- * Load program "progname" and start running it in usermode.
- * Does not return except on error.
- *
- * Calls vfs_open on progname and thus may destroy it.
- */
-int
-runprogram(char* progname, char** args, unsigned long argc)
-{
-	struct addrspace *as;
-	struct vnode *v;
-	vaddr_t entrypoint, stackptr;
-	int result;
-#if OPT_A2	
-	if (progname == NULL) {
-		return ENOENT;
-	}
-	if (argc > 64) {
-		return E2BIG;
-	}
-#elif
-	void(args);
-	void(argc);
-#endif /* OPT_A2 */
-		
-	/* Open the file. */
-	result = vfs_open(progname, O_RDONLY, 0, &v);
-	if (result) {
-		return result;
-	}
-	/* We should be a new process. */
-	KASSERT(curproc_getas() == NULL);
-	/* Create a new address space. */
-	as = as_create();
-	if (as ==NULL) {
-		vfs_close(v);
-		return ENOMEM;
-	}
-	/* Switch to it and activate it. */
-	curproc_setas(as);
-	as_activate();
-	/* Load the executable. */
-	result = load_elf(v, &entrypoint);
-	if (result) {
-		/* p_addrspace will go away when curproc is destroyed */
-		vfs_close(v);
-		return result;
-	}
-	/* Done with the file now. */
-	vfs_close(v);
-	/* Define the user stack in the address space */
-	result = as_define_stack(as, &stackptr);
-	if (result) {
-		/* p_addrspace will go away when curproc is destroyed */
-		return result;
-	}
-#if OPT_A2
-	vaddr_t vargptr[argc + 1];
-	for (int i = argc - 1; i >= 0; i--) {
-		stackptr -= ROUNDUP(strlen(args[i]) + 1, 8);
-		result = copyoutstr(args[i], (userptr_t)stackptr, strlen(args[i]) + 1, NULL);
-		if (result) {
-			return result;
-		}
-		vargptr[i] = stackptr;
-	}
-	vargptr[argc] = 0;
-	
-	for (int i = argc; i >= 0; i--) {
-		stackptr -= ROUNDUP(sizeof(vaddr_t), 4);
-		result = copyout(&vargptr[i], (userptr_t)stackptr, sizeof(vaddr_t));
-		if (result) {
-			return result;
-		}
-	}
-	// enter user mode
-	enter_new_process(argc, (userptr_t)stackptr, stackptr, entrypoint);
-#elif
-	/* Warp to user mode. */
-	enter_new_process(0 /*argc*/, NULL /*userspace addr of argv*/, stackptr, entrypoint);
-#endif /* OPT_A2 */
-		
-	/* enter_new_process does not return. */
-	panic("enter_new_process returned\n");
-	return EINVAL;
-}
\ No newline at end of file
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/*
+ * Sample/test code for running a user program.  You can use this for
+ * reference when implementing the execv() system call. Remember though
+ * that execv() needs to do more than this function does.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <kern/fcntl.h>
+#include <lib.h>
+#include <proc.h>
+#include <current.h>
+#include <addrspace.h>
+#include <vm.h>
+#include <vfs.h>
+#include <syscall.h>
+#include <test.h>
+#include <limits.h>
+#include <mips/trapframe.h>
+#include "opt-A2.h"
+#include <vfs.h>
+#include <kern/fcntl.h>
+#include <copyinout.h>
+#include <spinlock.h>
+#include <synch.h>
+#include <clock.h>
+#if OPT_A2
+/*
+ * Per-exec argument arena.
+ *
+ * Holds everything exec needs from its caller: the program path and
+ * up to ARGS_MAX argument strings totalling at most ARG_MAX bytes.
+ * The strings are packed into strs as they are copied in, and argv[]
+ * is built in the ptrs slots immediately below them, so the finished
+ * argv block is contiguous and reaches the new user stack with a
+ * single copyout. One arena is kept between execs so the common case
+ * does not allocate.
+ */
+#define ARGS_MAX 64
+struct arg_arena {
+	char path[PATH_MAX];
+	unsigned long argc;
+	size_t strbytes;		/* bytes of strs in use */
+	size_t offs[ARGS_MAX];		/* where each string starts in strs */
+	vaddr_t ptrs[ARGS_MAX + 1];	/* argv[], packed up against strs */
+	char strs[ARG_MAX + 8];		/* slack for rounding the copyout */
+};
+static struct spinlock arg_arena_lock = SPINLOCK_INITIALIZER;
+static struct arg_arena *arg_arena_cache = NULL;
+struct arg_arena *
+arg_arena_get(void)
+{
+	struct arg_arena *a;
+	spinlock_acquire(&arg_arena_lock);
+	a = arg_arena_cache;
+	arg_arena_cache = NULL;
+	spinlock_release(&arg_arena_lock);
+	if (a == NULL) {
+		a = kmalloc(sizeof(*a));
+		if (a == NULL) {
+			return NULL;
+		}
+	}
+	a->path[0] = '\0';
+	a->argc = 0;
+	a->strbytes = 0;
+	return a;
+}
+void
+arg_arena_put(struct arg_arena *a)
+{
+	spinlock_acquire(&arg_arena_lock);
+	if (arg_arena_cache == NULL) {
+		arg_arena_cache = a;
+		a = NULL;
+	}
+	spinlock_release(&arg_arena_lock);
+	if (a != NULL) {
+		kfree(a);
+	}
+}
+char *
+arg_arena_path(struct arg_arena *a)
+{
+	return a->path;
+}
+unsigned long
+arg_arena_argc(struct arg_arena *a)
+{
+	return a->argc;
+}
+/*
+ * Copy a user program path and NULL-terminated argv into the arena.
+ * Each string is copied exactly once, straight into place, bounded by
+ * the space left in the arena.
+ */
+int
+arg_arena_copyin(struct arg_arena *a, userptr_t progname, userptr_t args)
+{
+	userptr_t uarg;
+	size_t len;
+	int result;
+	result = copyinstr(progname, a->path, sizeof(a->path), NULL);
+	if (result) {
+		return result;
+	}
+	for (a->argc = 0; ; a->argc++) {
+		result = copyin((userptr_t)((vaddr_t)args + a->argc * sizeof(userptr_t)),
+				&uarg, sizeof(userptr_t));
+		if (result) {
+			return result;
+		}
+		if (uarg == NULL) {
+			return 0;
+		}
+		if (a->argc == ARGS_MAX) {
+			return E2BIG;
+		}
+		result = copyinstr(uarg, a->strs + a->strbytes,
+				   ARG_MAX - a->strbytes, &len);
+		if (result) {
+			return result == ENAMETOOLONG ? E2BIG : result;
+		}
+		a->offs[a->argc] = a->strbytes;
+		a->strbytes += len;
+	}
+}
+/*
+ * Same as arg_arena_copyin, for a path and arguments already in the
+ * kernel (e.g. from the menu).
+ */
+int
+arg_arena_setargs(struct arg_arena *a, const char *progname,
+		  char **args, unsigned long argc)
+{
+	if (strlen(progname) >= sizeof(a->path)) {
+		return ENAMETOOLONG;
+	}
+	if (argc > ARGS_MAX) {
+		return E2BIG;
+	}
+	strcpy(a->path, progname);
+	for (a->argc = 0; a->argc < argc; a->argc++) {
+		size_t len = strlen(args[a->argc]) + 1;
+		if (len > ARG_MAX - a->strbytes) {
+			return E2BIG;
+		}
+		memcpy(a->strs + a->strbytes, args[a->argc], len);
+		a->offs[a->argc] = a->strbytes;
+		a->strbytes += len;
+	}
+	return 0;
+}
+/*
+ * Lay out argv and its strings below *stackptr in the current address
+ * space with one copyout, and move *stackptr down past them. On
+ * success *stackptr is also the user address of argv.
+ */
+static
+int
+arg_arena_copyout(struct arg_arena *a, vaddr_t *stackptr)
+{
+	vaddr_t *argv = &a->ptrs[ARGS_MAX - a->argc];
+	size_t ptrbytes = (a->argc + 1) * sizeof(vaddr_t);
+	size_t len = ROUNDUP(ptrbytes + a->strbytes, 8);
+	vaddr_t base = *stackptr - len;
+	int result;
+	/* argv[] must run straight into the strings */
+	KASSERT((char *)&a->ptrs[ARGS_MAX + 1] == a->strs);
+	for (unsigned long i = 0; i < a->argc; i++) {
+		argv[i] = base + ptrbytes + a->offs[i];
+	}
+	argv[a->argc] = 0;
+	/* don't hand stale arena contents to userspace in the padding */
+	bzero(a->strs + a->strbytes, len - ptrbytes - a->strbytes);
+	result = copyout(argv, (userptr_t)base, len);
+	if (result) {
+		return result;
+	}
+	*stackptr = base;
+	return 0;
+}
+#endif /* OPT_A2 */
+/*
+ * Load program "progname" into a fresh address space for curproc and
+ * copy the arguments in args (if any) onto its user stack. On success
+ * *entrypoint and *stackptr are ready for enter_new_process;
+ * *stackptr is also the user address of argv. Used by runprogram and
+ * by spawn and execv.
+ *
+ * Calls vfs_open on progname and thus may destroy it.
+ */
+int
+loadprogram(char *progname, struct arg_arena *args,
+	    vaddr_t *entrypoint, vaddr_t *stackptr)
+{
+	struct addrspace *as;
+	struct vnode *v;
+	int result;
+	/* Open the file. */
+	result = vfs_open(progname, O_RDONLY, 0, &v);
+	if (result) {
+		return result;
+	}
+	/* We should be a new process. */
+	KASSERT(curproc_getas() == NULL);
+	/* Create a new address space. */
+	as = as_create();
+	if (as ==NULL) {
+		vfs_close(v);
+		return ENOMEM;
+	}
+	/* Switch to it and activate it. */
+	curproc_setas(as);
+	as_activate();
+	/* Load the executable. */
+	result = load_elf(v, entrypoint);
+	if (result) {
+		/* p_addrspace will go away when curproc is destroyed */
+		vfs_close(v);
+		return result;
+	}
+	/* Done with the file now. */
+	vfs_close(v);
+	/* Define the user stack in the address space */
+	result = as_define_stack(as, stackptr);
+	if (result) {
+		/* p_addrspace will go away when curproc is destroyed */
+		return result;
+	}
+#if OPT_A2
+	if (args != NULL) {
+		result = arg_arena_copyout(args, stackptr);
+		if (result) {
+			return result;
+		}
+	}
+#else
+	(void)args;
+#endif /* OPT_A2 */
+	return 0;
+}
+/*
+ * Load program "progname" and start running it in usermode.
+ * Does not return except on error.
+ *
+ * Calls vfs_open on progname and thus may destroy it.
+ */
+int
+runprogram(char* progname, char** args, unsigned long argc)
+{
+	vaddr_t entrypoint, stackptr;
+	int result;
+#if OPT_A2	
+	struct arg_arena *arena;
+	if (progname == NULL) {
+		return ENOENT;
+	}
+	arena = arg_arena_get();
+	if (arena == NULL) {
+		return ENOMEM;
+	}
+	result = arg_arena_setargs(arena, progname, args, argc);
+	if (result == 0) {
+		result = loadprogram(progname, arena, &entrypoint, &stackptr);
+	}
+	arg_arena_put(arena);
+#else
+	(void)args;
+	(void)argc;
+	result = loadprogram(progname, NULL, &entrypoint, &stackptr);
+#endif /* OPT_A2 */
+	if (result) {
+		return result;
+	}
+#if OPT_A2
+	// enter user mode
+	enter_new_process(argc, (userptr_t)stackptr, stackptr, entrypoint);
+#else
+	/* Warp to user mode. */
+	enter_new_process(0 /*argc*/, NULL /*userspace addr of argv*/, stackptr, entrypoint);
+#endif /* OPT_A2 */
+		
+	/* enter_new_process does not return. */
+	panic("enter_new_process returned\n");
+	return EINVAL;
+}
+#if OPT_A2
+/*
+ * Exec argument benchmark. In a fresh process with a program loaded,
+ * lays out ARGBENCH_ARGS arguments of ARGBENCH_LEN bytes on the user
+ * stack over and over, once through the arena (arg_arena_setargs and
+ * arg_arena_copyout, as exec does now) and once the way exec did it
+ * before the arena: a kmalloc'd copy of each string, then a
+ * copyoutstr per string and a copyout per argv pointer.
+ */
+#define ARGBENCH_ARGS ARGS_MAX
+#define ARGBENCH_LEN 512		/* per argument, with its NUL */
+#define ARGBENCH_ROUNDS 1000		/* default */
+#define ARGBENCH_PROGRAM "/bin/true"
+static struct semaphore *argbench_done;
+static char *argbench_program;
+static char **argbench_args;
+static unsigned long argbench_rounds;
+static int argbench_result;
+static
+int
+argbench_oldpath(char **args, unsigned long argc, vaddr_t stackptr)
+{
+	char **kargs;
+	vaddr_t uargv[ARGS_MAX + 1];
+	unsigned long i, n;
+	int result = 0;
+	kargs = kmalloc(sizeof(char *) * argc);
+	if (kargs == NULL) {
+		return ENOMEM;
+	}
+	for (n = 0; n < argc; n++) {
+		kargs[n] = kmalloc(strlen(args[n]) + 1);
+		if (kargs[n] == NULL) {
+			result = ENOMEM;
+			break;
+		}
+		strcpy(kargs[n], args[n]);
+	}
+	for (i = n; result == 0 && i-- > 0; ) {
+		stackptr -= ROUNDUP(strlen(kargs[i]) + 1, 8);
+		result = copyoutstr(kargs[i], (userptr_t)stackptr,
+				    strlen(kargs[i]) + 1, NULL);
+		uargv[i] = stackptr;
+	}
+	uargv[argc] = 0;
+	for (i = argc + 1; result == 0 && i-- > 0; ) {
+		stackptr -= sizeof(vaddr_t);
+		result = copyout(&uargv[i], (userptr_t)stackptr, sizeof(vaddr_t));
+	}
+	for (i = 0; i < n; i++) {
+		kfree(kargs[i]);
+	}
+	kfree(kargs);
+	return result;
+}
+static
+int
+argbench_newpath(char **args, unsigned long argc, vaddr_t stackptr)
+{
+	struct arg_arena *a;
+	int result;
+	a = arg_arena_get();
+	if (a == NULL) {
+		return ENOMEM;
+	}
+	result = arg_arena_setargs(a, argbench_program, args, argc);
+	if (result == 0) {
+		result = arg_arena_copyout(a, &stackptr);
+	}
+	arg_arena_put(a);
+	return result;
+}
+/* Time rounds of path; returns the ns per round, or 0 on error. */
+static
+unsigned long
+argbench_time(int (*path)(char **, unsigned long, vaddr_t), vaddr_t stackptr)
+{
+	time_t beforesecs, aftersecs, secs;
+	uint32_t beforensecs, afternsecs, nsecs;
+	gettime(&beforesecs, &beforensecs);
+	for (unsigned long i = 0; i < argbench_rounds; i++) {
+		argbench_result = path(argbench_args, ARGBENCH_ARGS, stackptr);
+		if (argbench_result) {
+			return 0;
+		}
+	}
+	gettime(&aftersecs, &afternsecs);
+	getinterval(beforesecs, beforensecs, aftersecs, afternsecs,
+		    &secs, &nsecs);
+	return ((unsigned long)secs * 1000000000 + nsecs) / argbench_rounds;
+}
+static
+void
+argbench_thread(void *unused1, unsigned long unused2)
+{
+	struct addrspace *as;
+	vaddr_t entrypoint, stackptr;
+	unsigned long oldns = 0, newns = 0;
+	char *path;
+	(void)unused1;
+	(void)unused2;
+	/* loadprogram may destroy the path */
+	path = kstrdup(argbench_program);
+	if (path == NULL) {
+		argbench_result = ENOMEM;
+	}
+	else {
+		argbench_result = loadprogram(path, NULL, &entrypoint, &stackptr);
+		kfree(path);
+	}
+	if (argbench_result == 0) {
+		oldns = argbench_time(argbench_oldpath, stackptr);
+		if (argbench_result == 0) {
+			newns = argbench_time(argbench_newpath, stackptr);
+		}
+		if (argbench_result == 0) {
+			kprintf("argbench: %d args of %d bytes, ns per exec: "
+				"arena %lu, per-string kmalloc %lu\n",
+				ARGBENCH_ARGS, ARGBENCH_LEN, newns, oldns);
+		}
+	}
+	/* tear down as sys__exit does, without entering user mode */
+	as = curproc_setas(NULL);
+	if (as != NULL) {
+		as_deactivate();
+		as_destroy(as);
+	}
+	proc_remthread(curthread);
+	V(argbench_done);
+	thread_exit();
+}
+/*
+ * pt4 [rounds [program]]: the exec argument benchmark above. program
+ * (default /bin/true) is loaded to get a user stack but never run.
+ */
+int
+argbench(int nargs, char **args)
+{
+	struct proc *proc;
+	int i;
+	argbench_rounds = (nargs > 1) ? (unsigned long)atoi(args[1]) :
+		ARGBENCH_ROUNDS;
+	argbench_program = (nargs > 2) ? args[2] : ARGBENCH_PROGRAM;
+	if (argbench_rounds == 0) {
+		return EINVAL;
+	}
+	argbench_done = sem_create("argbench_done", 0);
+	argbench_args = kmalloc(sizeof(char *) * ARGBENCH_ARGS);
+	if (argbench_done == NULL || argbench_args == NULL) {
+		panic("argbench: out of memory\n");
+	}
+	for (i = 0; i < ARGBENCH_ARGS; i++) {
+		argbench_args[i] = kmalloc(ARGBENCH_LEN);
+		if (argbench_args[i] == NULL) {
+			panic("argbench: out of memory\n");
+		}
+		memset(argbench_args[i], 'a' + i % 26, ARGBENCH_LEN - 1);
+		argbench_args[i][ARGBENCH_LEN - 1] = '\0';
+	}
+	proc = proc_create_runprogram("argbench");
+	if (proc == NULL) {
+		panic("argbench: out of memory\n");
+	}
+	if (thread_fork("argbench", proc, argbench_thread, NULL, 0)) {
+		argbench_result = ENOMEM;
+	}
+	else {
+		P(argbench_done);
+	}
+	proc_destroy(proc);
+#ifdef UW
+	/* proc_destroy V'd no_proc_sem; nobody is waiting for it */
+	sem_tryP(no_proc_sem);
+#endif // UW
+	for (i = 0; i < ARGBENCH_ARGS; i++) {
+		kfree(argbench_args[i]);
+	}
+	kfree(argbench_args);
+	sem_destroy(argbench_done);
+	if (argbench_result) {
+		kprintf("argbench: %s: %s\n", argbench_program,
+			strerror(argbench_result));
+	}
+	return 0;
+}
+#endif /* OPT_A2 */
\ No newline at end of file
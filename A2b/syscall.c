@@ -1,190 +1,592 @@
-/*
- * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
- *	The President and Fellows of Harvard College.
- *
- * Redistribution and use in source and binary forms, with or without
- * modification, are permitted provided that the following conditions
- * are met:
- * 1. Redistributions of source code must retain the above copyright
- *    notice, this list of conditions and the following disclaimer.
- * 2. Redistributions in binary form must reproduce the above copyright
- *    notice, this list of conditions and the following disclaimer in the
- *    documentation and/or other materials provided with the distribution.
- * 3. Neither the name of the University nor the names of its contributors
- *    may be used to endorse or promote products derived from this software
- *    without specific prior written permission.
- *
- * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
- * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
- * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
- * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
- * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
- * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
- * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
- * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
- * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
- * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
- * SUCH DAMAGE.
- */
-#include <types.h>
-#include <kern/errno.h>
-#include <kern/syscall.h>
-#include <lib.h>
-#include <mips/trapframe.h>
-#include <thread.h>
-#include <current.h>
-#include <syscall.h>
-#include "opt-A2.h"
-/*
- * System call dispatcher.
- *
- * A pointer to the trapframe created during exception entry (in
- * exception.S) is passed in.
- *
- * The calling conventions for syscalls are as follows: Like ordinary
- * function calls, the first 4 32-bit arguments are passed in the 4
- * argument registers a0-a3. 64-bit arguments are passed in *aligned*
- * pairs of registers, that is, either a0/a1 or a2/a3. This means that
- * if the first argument is 32-bit and the second is 64-bit, a1 is
- * unused.
- *
- * This much is the same as the calling conventions for ordinary
- * function calls. In addition, the system call number is passed in
- * the v0 register.
- *
- * On successful return, the return value is passed back in the v0
- * register, or v0 and v1 if 64-bit. This is also like an ordinary
- * function call, and additionally the a3 register is also set to 0 to
- * indicate success.
- *
- * On an error return, the error code is passed back in the v0
- * register, and the a3 register is set to 1 to indicate failure.
- * (Userlevel code takes care of storing the error code in errno and
- * returning the value -1 from the actual userlevel syscall function.
- * See src/user/lib/libc/arch/mips/syscalls-mips.S and related files.)
- *
- * Upon syscall return the program counter stored in the trapframe
- * must be incremented by one instruction; otherwise the exception
- * return code will restart the "syscall" instruction and the system
- * call will repeat forever.
- *
- * If you run out of registers (which happens quickly with 64-bit
- * values) further arguments must be fetched from the user-level
- * stack, starting at sp+16 to skip over the slots for the
- * registerized values, with copyin().
- */
-void
-syscall(struct trapframe *tf)
-{
-	int callno;
-	int32_t retval;
-	int err;
-	KASSERT(curthread != NULL);
-	KASSERT(curthread->t_curspl == 0);
-	KASSERT(curthread->t_iplhigh_count == 0);
-	callno = tf->tf_v0;
-	/*
-	 * Initialize retval to 0. Many of the system calls don't
-	 * really return a value, just 0 for success and -1 on
-	 * error. Since retval is the value returned on success,
-	 * initialize it to 0 by default; thus it's not necessary to
-	 * deal with it except for calls that return other values, 
-	 * like write.
-	 */
-	retval = 0;
-	switch (callno) {
-	    case SYS_reboot:
-		err = sys_reboot(tf->tf_a0);
-		break;
-	    case SYS___time:
-		err = sys___time((userptr_t)tf->tf_a0,
-				 (userptr_t)tf->tf_a1);
-		break;
-#ifdef UW
-	case SYS_write:
-	  err = sys_write((int)tf->tf_a0,
-			  (userptr_t)tf->tf_a1,
-			  (int)tf->tf_a2,
-			  (int *)(&retval));
-	  break;
-#if OPT_A2
-	case SYS_fork:
-	  err = sys_fork(tf,(pid_t *)&retval);
-	  break;
-	case SYS_execv:
-	  err = sys_execv((userptr_t)tf->tf_a0, (userptr_t)tf->tf_a1);
-	  break;
-#endif /* OPT_A2 */
-	case SYS__exit:
-	  sys__exit((int)tf->tf_a0);
-	  /* sys__exit does not return, execution should not get here */
-	  panic("unexpected return from sys__exit");
-	  break;
-	case SYS_getpid:
-	  err = sys_getpid((pid_t *)&retval);
-	  break;
-	case SYS_waitpid:
-	  err = sys_waitpid((pid_t)tf->tf_a0,
-			    (userptr_t)tf->tf_a1,
-			    (int)tf->tf_a2,
-			    (pid_t *)&retval);
-	  break;
-#endif // UW
-	    /* Add stuff here */
- 
-	default:
-	  kprintf("Unknown syscall %d\n", callno);
-	  err = ENOSYS;
-	  break;
-	}
-	if (err) {
-		/*
-		 * Return the error code. This gets converted at
-		 * userlevel to a return value of -1 and the error
-		 * code in errno.
-		 */
-		tf->tf_v0 = err;
-		tf->tf_a3 = 1;      /* signal an error */
-	}
-	else {
-		/* Success. */
-		tf->tf_v0 = retval;
-		tf->tf_a3 = 0;      /* signal no error */
-	}
-	
-	/*
-	 * Now, advance the program counter, to avoid restarting
-	 * the syscall over and over again.
-	 */
-	
-	tf->tf_epc += 4;
-	/* Make sure the syscall code didn't forget to lower spl */
-	KASSERT(curthread->t_curspl == 0);
-	/* ...or leak any spinlocks */
-	KASSERT(curthread->t_iplhigh_count == 0);
-}
-/*
- * Enter user mode for a newly forked process.
- *
- * This function is provided as a reminder. You need to write
- * both it and the code that calls it.
- *
- * Thus, you can trash it and do things another way if you prefer.
- */
-void enter_forked_process(void *tf, unsigned long data) {
-	// Copy the trapframe so it is local on the kernel stack
-	// and can be passed into mips_usermode
-	struct trapframe *ftf = tf;
-	struct trapframe localtf = *ftf;
-	// don't need this
-	(void)data;
-	// set v0=0 to indicate return value of child
-	localtf.tf_v0 = 0;
-	// set a3=0 to indicate succesful fork call
-	localtf.tf_a3 = 0;
-	// Advance program counter by 4 so system call isn't called again
-	localtf.tf_epc += 4;
-	// Don't need intermediate variable so we can free
-	kfree(ftf);
-	mips_usermode(&localtf);
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <kern/syscall.h>
+#include <kern/unistd.h>
+#include <lib.h>
+#include <mips/trapframe.h>
+#include <thread.h>
+#include <current.h>
+#include <syscall.h>
+#include <spinlock.h>
+#include <spl.h>
+#include <cpu.h>
+#include <proc.h>
+#include <conbuf.h>
+#include <copyinout.h>
+#include <trace.h>
+#include "opt-A2.h"
+#if OPT_A2
+/*
+ * Small cache of trapframes for fork. The parent copies its trapframe
+ * into one, and enter_forked_process hands it back once the child has
+ * its own copy on its stack.
+ */
+#define FORKTF_CACHE_MAX 8
+static struct spinlock forktf_lock = SPINLOCK_INITIALIZER;
+static struct trapframe *forktf_cache[FORKTF_CACHE_MAX];
+static unsigned forktf_num = 0;
+struct trapframe *
+forktf_alloc(void)
+{
+	struct trapframe *tf = NULL;
+	spinlock_acquire(&forktf_lock);
+	if (forktf_num > 0) {
+		tf = forktf_cache[--forktf_num];
+	}
+	spinlock_release(&forktf_lock);
+	if (tf == NULL) {
+		tf = kmalloc(sizeof(struct trapframe));
+	}
+	return tf;
+}
+void
+forktf_free(struct trapframe *tf)
+{
+	spinlock_acquire(&forktf_lock);
+	if (forktf_num < FORKTF_CACHE_MAX) {
+		forktf_cache[forktf_num++] = tf;
+		tf = NULL;
+	}
+	spinlock_release(&forktf_lock);
+	if (tf != NULL) {
+		kfree(tf);
+	}
+}
+/*
+ * Syscall dispatch table.
+ *
+ * Each entry adapts the trapframe to one handler and keeps accounting
+ * for that call: how often it ran, how often it failed, and a log2
+ * histogram of how many cycles it took (bucket i counts calls taking
+ * [2^i, 2^(i+1)) cycles). The counters are bumped without locking, so
+ * with several CPUs a few updates may be lost; they are for profiling,
+ * not bookkeeping. Dump them with syscall_stats_print ("ss" in the
+ * menu).
+ */
+#define SYSCALL_HIST_BUCKETS 32
+#define SYSCALL_TABLE_SIZE (SYS_batch + 1)
+struct syscall_desc {
+	const char *sd_name;
+	int (*sd_handler)(struct trapframe *tf, int32_t *retval);
+	bool sd_batchable;		/* may be queued through batch() */
+	volatile uint32_t sd_calls;
+	volatile uint32_t sd_errors;
+	volatile uint32_t sd_hist[SYSCALL_HIST_BUCKETS];
+};
+static
+int
+sc_reboot(struct trapframe *tf, int32_t *retval)
+{
+	(void)retval;
+	return sys_reboot(tf->tf_a0);
+}
+static
+int
+sc_time(struct trapframe *tf, int32_t *retval)
+{
+	(void)retval;
+	return sys___time((userptr_t)tf->tf_a0, (userptr_t)tf->tf_a1);
+}
+static
+int
+sc_write(struct trapframe *tf, int32_t *retval)
+{
+	int fd = (int)tf->tf_a0;
+	if (fd == STDOUT_FILENO || fd == STDERR_FILENO) {
+		/* console output goes through the buffer in conbuf.c */
+		size_t written;
+		int err = conbufWrite((userptr_t)tf->tf_a1,
+				      (size_t)tf->tf_a2, &written);
+		if (err == 0) {
+			*retval = written;
+		}
+		return err;
+	}
+	return sys_write((int)tf->tf_a0, (userptr_t)tf->tf_a1,
+			 (int)tf->tf_a2, (int *)retval);
+}
+static
+int
+sc_fork(struct trapframe *tf, int32_t *retval)
+{
+	return sys_fork(tf, (pid_t *)retval);
+}
+static
+int
+sc_vfork(struct trapframe *tf, int32_t *retval)
+{
+	return sys_vfork(tf, (pid_t *)retval);
+}
+static
+int
+sc_execv(struct trapframe *tf, int32_t *retval)
+{
+	(void)retval;
+	return sys_execv((userptr_t)tf->tf_a0, (userptr_t)tf->tf_a1);
+}
+static
+int
+sc_spawn(struct trapframe *tf, int32_t *retval)
+{
+	return sys_spawn((userptr_t)tf->tf_a0, (userptr_t)tf->tf_a1,
+			 (pid_t *)retval);
+}
+static
+int
+sc_exit(struct trapframe *tf, int32_t *retval)
+{
+	(void)retval;
+	sys__exit((int)tf->tf_a0);
+	/* sys__exit does not return, execution should not get here */
+	panic("unexpected return from sys__exit");
+	return 0;
+}
+static
+int
+sc_getpid(struct trapframe *tf, int32_t *retval)
+{
+	(void)tf;
+	return sys_getpid((pid_t *)retval);
+}
+static
+int
+sc_waitpid(struct trapframe *tf, int32_t *retval)
+{
+	return sys_waitpid((pid_t)tf->tf_a0, (userptr_t)tf->tf_a1,
+			   (int)tf->tf_a2, (pid_t *)retval);
+}
+static
+int
+sc_batch(struct trapframe *tf, int32_t *retval)
+{
+	return sys_batch((userptr_t)tf->tf_a0, (unsigned)tf->tf_a1, retval);
+}
+static struct syscall_desc syscall_table[SYSCALL_TABLE_SIZE] = {
+	[SYS_reboot] =	{ .sd_name = "reboot",	.sd_handler = sc_reboot },
+	[SYS___time] =	{ .sd_name = "__time",	.sd_handler = sc_time },
+	[SYS_write] =	{ .sd_name = "write",	.sd_handler = sc_write,
+			  .sd_batchable = true },
+	[SYS_fork] =	{ .sd_name = "fork",	.sd_handler = sc_fork },
+	[SYS_vfork] =	{ .sd_name = "vfork",	.sd_handler = sc_vfork },
+	[SYS_execv] =	{ .sd_name = "execv",	.sd_handler = sc_execv },
+	[SYS_spawn] =	{ .sd_name = "spawn",	.sd_handler = sc_spawn },
+	[SYS__exit] =	{ .sd_name = "_exit",	.sd_handler = sc_exit },
+	[SYS_getpid] =	{ .sd_name = "getpid",	.sd_handler = sc_getpid,
+			  .sd_batchable = true },
+	[SYS_waitpid] =	{ .sd_name = "waitpid",	.sd_handler = sc_waitpid,
+			  .sd_batchable = true },
+	[SYS_batch] =	{ .sd_name = "batch",	.sd_handler = sc_batch },
+};
+/*
+ * Syscall trace rings.
+ *
+ * When tracing is on, every completed syscall is recorded in a ring
+ * belonging to the CPU it ran on. Each CPU only ever writes its own
+ * ring, with interrupts off for the few stores involved, so recording
+ * takes no lock. The rings are allocated the first time tracing is
+ * turned on and kept afterwards so they can be dumped after it is
+ * turned off again. With tracing off the cost is one load and branch.
+ * _exit never completes and so is never recorded.
+ */
+#define SYSTRACE_MAXCPUS 8
+#define SYSTRACE_RING_SIZE 128		/* power of 2 */
+struct systrace_rec {
+	uint32_t tr_start;		/* cycle count at entry */
+	uint32_t tr_cycles;
+	pid_t tr_pid;
+	int tr_callno;
+	uint32_t tr_args[4];
+	int32_t tr_retval;
+	int tr_err;
+};
+struct systrace_ring {
+	unsigned tr_head;		/* total records ever written */
+	struct systrace_rec tr_recs[SYSTRACE_RING_SIZE];
+};
+static struct systrace_ring *systrace_rings[SYSTRACE_MAXCPUS];
+static volatile bool systrace_on = false;
+int
+syscall_trace_enable(bool on)
+{
+	if (on) {
+		for (unsigned i = 0; i < SYSTRACE_MAXCPUS; i++) {
+			if (systrace_rings[i] != NULL) {
+				continue;
+			}
+			systrace_rings[i] = kmalloc(sizeof(struct systrace_ring));
+			if (systrace_rings[i] == NULL) {
+				return ENOMEM;
+			}
+			systrace_rings[i]->tr_head = 0;
+		}
+	}
+	systrace_on = on;
+	return 0;
+}
+static
+void
+syscall_trace_record(int callno, const uint32_t *args,
+		     uint32_t start, uint32_t cycles, int32_t retval, int err)
+{
+	struct systrace_ring *ring;
+	struct systrace_rec *rec;
+	int spl;
+	spl = splhigh();
+	if (curcpu->c_number < SYSTRACE_MAXCPUS) {
+		ring = systrace_rings[curcpu->c_number];
+		rec = &ring->tr_recs[ring->tr_head++ & (SYSTRACE_RING_SIZE - 1)];
+		rec->tr_start = start;
+		rec->tr_cycles = cycles;
+		rec->tr_pid = curproc->pid;
+		rec->tr_callno = callno;
+		memcpy(rec->tr_args, args, sizeof(rec->tr_args));
+		rec->tr_retval = retval;
+		rec->tr_err = err;
+	}
+	splx(spl);
+}
+void
+syscall_trace_print(void)
+{
+	for (unsigned i = 0; i < SYSTRACE_MAXCPUS; i++) {
+		struct systrace_ring *ring = systrace_rings[i];
+		unsigned n, first;
+		if (ring == NULL || ring->tr_head == 0) {
+			continue;
+		}
+		n = ring->tr_head < SYSTRACE_RING_SIZE ?
+			ring->tr_head : SYSTRACE_RING_SIZE;
+		first = ring->tr_head - n;
+		kprintf("cpu%u: %u records (%u total)\n", i, n, ring->tr_head);
+		for (unsigned j = first; j < first + n; j++) {
+			struct systrace_rec *rec =
+				&ring->tr_recs[j & (SYSTRACE_RING_SIZE - 1)];
+			kprintf("  %08x pid %d %s(%x, %x, %x, %x) = %d",
+				rec->tr_start, rec->tr_pid,
+				syscall_table[rec->tr_callno].sd_name,
+				rec->tr_args[0], rec->tr_args[1],
+				rec->tr_args[2], rec->tr_args[3],
+				rec->tr_err ? -1 : rec->tr_retval);
+			if (rec->tr_err) {
+				kprintf(" (%s)", strerror(rec->tr_err));
+			}
+			kprintf(" [%u cycles]\n", rec->tr_cycles);
+		}
+	}
+}
+/*
+ * Run the handler for callno, which must be in the table, and account
+ * for it.
+ */
+static
+int
+syscall_invoke(int callno, struct trapframe *tf, int32_t *retval)
+{
+	struct syscall_desc *sd = &syscall_table[callno];
+	uint32_t start, cycles;
+	unsigned bucket = 0;
+	bool traced = systrace_on;
+	uint32_t args[4];
+	int err;
+	if (traced) {
+		/* the handler may change the trapframe (e.g. execv) */
+		args[0] = tf->tf_a0;
+		args[1] = tf->tf_a1;
+		args[2] = tf->tf_a2;
+		args[3] = tf->tf_a3;
+	}
+	/* counted up front: _exit never comes back */
+	sd->sd_calls++;
+	start = trace_cycles();
+	err = sd->sd_handler(tf, retval);
+	cycles = trace_cycles() - start;
+	if (traced) {
+		syscall_trace_record(callno, args, start, cycles,
+				     *retval, err);
+	}
+	while (cycles >>= 1) {
+		bucket++;
+	}
+	sd->sd_hist[bucket]++;
+	if (err) {
+		sd->sd_errors++;
+	}
+	return err;
+}
+/*
+ * batch(entries, n): run n queued syscalls from a user array of struct
+ * batch_entry in one kernel entry, filling in each entry's result.
+ * Entries are copied in and back out a chunk at a time. Only calls
+ * marked sd_batchable may be queued; any other call number completes
+ * with ENOSYS without stopping the batch. Returns the number of
+ * entries run, which is n unless copying an entry in or out failed
+ * part way through.
+ */
+#define BATCH_CHUNK 16
+int
+sys_batch(userptr_t entries, unsigned n, int32_t *retval)
+{
+	struct batch_entry batch[BATCH_CHUNK];
+	struct trapframe tf;
+	unsigned done = 0;
+	int result = 0;
+	while (done < n) {
+		unsigned chunk = n - done < BATCH_CHUNK ? n - done : BATCH_CHUNK;
+		userptr_t uptr = (userptr_t)((vaddr_t)entries +
+					     done * sizeof(struct batch_entry));
+		result = copyin(uptr, batch, chunk * sizeof(struct batch_entry));
+		if (result) {
+			break;
+		}
+		for (unsigned i = 0; i < chunk; i++) {
+			struct batch_entry *be = &batch[i];
+			int callno = be->be_callno;
+			be->be_retval = 0;
+			if (callno < 0 || callno >= SYSCALL_TABLE_SIZE ||
+			    !syscall_table[callno].sd_batchable) {
+				be->be_err = ENOSYS;
+				continue;
+			}
+			bzero(&tf, sizeof(tf));
+			tf.tf_v0 = callno;
+			tf.tf_a0 = be->be_args[0];
+			tf.tf_a1 = be->be_args[1];
+			tf.tf_a2 = be->be_args[2];
+			be->be_err = syscall_invoke(callno, &tf, &be->be_retval);
+		}
+		result = copyout(batch, uptr, chunk * sizeof(struct batch_entry));
+		if (result) {
+			break;
+		}
+		done += chunk;
+	}
+	if (done == 0 && n > 0) {
+		return result;
+	}
+	*retval = done;
+	return 0;
+}
+void
+syscall_stats_print(void)
+{
+	kprintf("%-8s %10s %10s  %s\n", "syscall", "calls", "errors",
+		"log2(cycles): count");
+	for (unsigned i = 0; i < SYSCALL_TABLE_SIZE; i++) {
+		struct syscall_desc *sd = &syscall_table[i];
+		if (sd->sd_handler == NULL || sd->sd_calls == 0) {
+			continue;
+		}
+		kprintf("%-8s %10u %10u ", sd->sd_name,
+			(unsigned)sd->sd_calls, (unsigned)sd->sd_errors);
+		for (unsigned b = 0; b < SYSCALL_HIST_BUCKETS; b++) {
+			if (sd->sd_hist[b] != 0) {
+				kprintf(" %u:%u", b, (unsigned)sd->sd_hist[b]);
+			}
+		}
+		kprintf("\n");
+	}
+}
+#endif /* OPT_A2 */
+/*
+ * System call dispatcher.
+ *
+ * A pointer to the trapframe created during exception entry (in
+ * exception.S) is passed in.
+ *
+ * The calling conventions for syscalls are as follows: Like ordinary
+ * function calls, the first 4 32-bit arguments are passed in the 4
+ * argument registers a0-a3. 64-bit arguments are passed in *aligned*
+ * pairs of registers, that is, either a0/a1 or a2/a3. This means that
+ * if the first argument is 32-bit and the second is 64-bit, a1 is
+ * unused.
+ *
+ * This much is the same as the calling conventions for ordinary
+ * function calls. In addition, the system call number is passed in
+ * the v0 register.
+ *
+ * On successful return, the return value is passed back in the v0
+ * register, or v0 and v1 if 64-bit. This is also like an ordinary
+ * function call, and additionally the a3 register is also set to 0 to
+ * indicate success.
+ *
+ * On an error return, the error code is passed back in the v0
+ * register, and the a3 register is set to 1 to indicate failure.
+ * (Userlevel code takes care of storing the error code in errno and
+ * returning the value -1 from the actual userlevel syscall function.
+ * See src/user/lib/libc/arch/mips/syscalls-mips.S and related files.)
+ *
+ * Upon syscall return the program counter stored in the trapframe
+ * must be incremented by one instruction; otherwise the exception
+ * return code will restart the "syscall" instruction and the system
+ * call will repeat forever.
+ *
+ * If you run out of registers (which happens quickly with 64-bit
+ * values) further arguments must be fetched from the user-level
+ * stack, starting at sp+16 to skip over the slots for the
+ * registerized values, with copyin().
+ */
+void
+syscall(struct trapframe *tf)
+{
+	int callno;
+	int32_t retval;
+	int err;
+	KASSERT(curthread != NULL);
+	KASSERT(curthread->t_curspl == 0);
+	KASSERT(curthread->t_iplhigh_count == 0);
+	callno = tf->tf_v0;
+	/*
+	 * Initialize retval to 0. Many of the system calls don't
+	 * really return a value, just 0 for success and -1 on
+	 * error. Since retval is the value returned on success,
+	 * initialize it to 0 by default; thus it's not necessary to
+	 * deal with it except for calls that return other values, 
+	 * like write.
+	 */
+	retval = 0;
+#if OPT_A2
+	if (callno >= 0 && callno < SYSCALL_TABLE_SIZE &&
+	    syscall_table[callno].sd_handler != NULL) {
+		err = syscall_invoke(callno, tf, &retval);
+	}
+	else {
+		kprintf("Unknown syscall %d\n", callno);
+		err = ENOSYS;
+	}
+#else
+	switch (callno) {
+	    case SYS_reboot:
+		err = sys_reboot(tf->tf_a0);
+		break;
+	    case SYS___time:
+		err = sys___time((userptr_t)tf->tf_a0,
+				 (userptr_t)tf->tf_a1);
+		break;
+#ifdef UW
+	case SYS_write:
+	  err = sys_write((int)tf->tf_a0,
+			  (userptr_t)tf->tf_a1,
+			  (int)tf->tf_a2,
+			  (int *)(&retval));
+	  break;
+#if OPT_A2
+	case SYS_fork:
+	  err = sys_fork(tf,(pid_t *)&retval);
+	  break;
+	case SYS_vfork:
+	  err = sys_vfork(tf,(pid_t *)&retval);
+	  break;
+	case SYS_execv:
+	  err = sys_execv((userptr_t)tf->tf_a0, (userptr_t)tf->tf_a1);
+	  break;
+	case SYS_spawn:
+	  err = sys_spawn((userptr_t)tf->tf_a0, (userptr_t)tf->tf_a1,
+			  (pid_t *)&retval);
+	  break;
+#endif /* OPT_A2 */
+	case SYS__exit:
+	  sys__exit((int)tf->tf_a0);
+	  /* sys__exit does not return, execution should not get here */
+	  panic("unexpected return from sys__exit");
+	  break;
+	case SYS_getpid:
+	  err = sys_getpid((pid_t *)&retval);
+	  break;
+	case SYS_waitpid:
+	  err = sys_waitpid((pid_t)tf->tf_a0,
+			    (userptr_t)tf->tf_a1,
+			    (int)tf->tf_a2,
+			    (pid_t *)&retval);
+	  break;
+#endif // UW
+	    /* Add stuff here */
+ 
+	default:
+	  kprintf("Unknown syscall %d\n", callno);
+	  err = ENOSYS;
+	  break;
+	}
+#endif /* OPT_A2 */
+	if (err) {
+		/*
+		 * Return the error code. This gets converted at
+		 * userlevel to a return value of -1 and the error
+		 * code in errno.
+		 */
+		tf->tf_v0 = err;
+		tf->tf_a3 = 1;      /* signal an error */
+	}
+	else {
+		/* Success. */
+		tf->tf_v0 = retval;
+		tf->tf_a3 = 0;      /* signal no error */
+	}
+	
+	/*
+	 * Now, advance the program counter, to avoid restarting
+	 * the syscall over and over again.
+	 */
+	
+	tf->tf_epc += 4;
+	/* Make sure the syscall code didn't forget to lower spl */
+	KASSERT(curthread->t_curspl == 0);
+	/* ...or leak any spinlocks */
+	KASSERT(curthread->t_iplhigh_count == 0);
+}
+/*
+ * Enter user mode for a newly forked process.
+ *
+ * This function is provided as a reminder. You need to write
+ * both it and the code that calls it.
+ *
+ * Thus, you can trash it and do things another way if you prefer.
+ */
+void enter_forked_process(void *tf, unsigned long data) {
+	// Copy the trapframe so it is local on the kernel stack
+	// and can be passed into mips_usermode
+	struct trapframe *ftf = tf;
+	struct trapframe localtf = *ftf;
+	// don't need this
+	(void)data;
+	// set v0=0 to indicate return value of child
+	localtf.tf_v0 = 0;
+	// set a3=0 to indicate succesful fork call
+	localtf.tf_a3 = 0;
+	// Advance program counter by 4 so system call isn't called again
+	localtf.tf_epc += 4;
+	// Don't need intermediate variable so we can free
+#if OPT_A2
+	forktf_free(ftf);
+#else
+	kfree(ftf);
+#endif /* OPT_A2 */
+	mips_usermode(&localtf);
 }
\ No newline at end of file
@@ -1,60 +1,99 @@
-/*
- * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
- *	The President and Fellows of Harvard College.
- *
- * Redistribution and use in source and binary forms, with or without
- * modification, are permitted provided that the following conditions
- * are met:
- * 1. Redistributions of source code must retain the above copyright
- *    notice, this list of conditions and the following disclaimer.
- * 2. Redistributions in binary form must reproduce the above copyright
- *    notice, this list of conditions and the following disclaimer in the
- *    documentation and/or other materials provided with the distribution.
- * 3. Neither the name of the University nor the names of its contributors
- *    may be used to endorse or promote products derived from this software
- *    without specific prior written permission.
- *
- * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
- * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
- * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
- * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
- * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
- * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
- * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
- * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
- * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
- * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
- * SUCH DAMAGE.
- */
-#ifndef _SYSCALL_H_
-#define _SYSCALL_H_
-#include "opt-A2.h"
-struct trapframe; /* from <machine/trapframe.h> */
-/*
- * The system call dispatcher.
- */
-void syscall(struct trapframe *tf);
-/*
- * Support functions.
- */
-/* Helper for fork(). You write this. */
-void enter_forked_process(void *tf, unsigned long data);
-/* Enter user mode. Does not return. */
-void enter_new_process(int argc, userptr_t argv, vaddr_t stackptr,
-		       vaddr_t entrypoint);
-/*
- * Prototypes for IN-KERNEL entry points for system call implementations.
- */
-int sys_reboot(int code);
-int sys___time(userptr_t user_seconds, userptr_t user_nanoseconds);
-#ifdef UW
-int sys_write(int fdesc,userptr_t ubuf,unsigned int nbytes,int *retval);
-void sys__exit(int exitcode);
-int sys_getpid(pid_t *retval);
-int sys_waitpid(pid_t pid, userptr_t status, int options, pid_t *retval);
-#if OPT_A2
-int sys_fork(struct trapframe *currenttf, pid_t *retval);
-int sys_execv(userptr_t progname, userptr_t args); 
-#endif /* OPT_A2 */
-#endif // UW
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef _SYSCALL_H_
+#define _SYSCALL_H_
+#include "opt-A2.h"
+struct trapframe; /* from <machine/trapframe.h> */
+#if OPT_A2
+/*
+ * Call number for spawn(path, argv). Not part of the stock
+ * <kern/syscall.h>, so it is placed above the stock numbers;
+ * userland's stub must use the same number.
+ */
+#ifndef SYS_spawn
+#define SYS_spawn 130
+#endif
+/*
+ * batch(entries, n) runs n queued syscalls in one kernel entry. Each
+ * entry names a call and up to three register arguments; the kernel
+ * fills in be_retval and be_err (0 on success) as the call would have
+ * returned them. Only write, getpid and waitpid may be queued.
+ * Userland must use the same call number and entry layout.
+ */
+#ifndef SYS_batch
+#define SYS_batch 131
+#endif
+struct batch_entry {
+	int32_t be_callno;
+	uint32_t be_args[3];
+	int32_t be_retval;
+	int32_t be_err;
+};
+#endif /* OPT_A2 */
+/*
+ * The system call dispatcher.
+ */
+void syscall(struct trapframe *tf);
+/*
+ * Support functions.
+ */
+/* Helper for fork(). You write this. */
+void enter_forked_process(void *tf, unsigned long data);
+#if OPT_A2
+/* Trapframes handed from fork to enter_forked_process, recycled. */
+struct trapframe *forktf_alloc(void);
+void forktf_free(struct trapframe *tf);
+/* Print per-syscall call/error counts and latency histograms. */
+void syscall_stats_print(void);
+/* Turn syscall tracing on or off, and print the trace rings. */
+int syscall_trace_enable(bool on);
+void syscall_trace_print(void);
+#endif /* OPT_A2 */
+/* Enter user mode. Does not return. */
+void enter_new_process(int argc, userptr_t argv, vaddr_t stackptr,
+		       vaddr_t entrypoint);
+/*
+ * Prototypes for IN-KERNEL entry points for system call implementations.
+ */
+int sys_reboot(int code);
+int sys___time(userptr_t user_seconds, userptr_t user_nanoseconds);
+#ifdef UW
+int sys_write(int fdesc,userptr_t ubuf,unsigned int nbytes,int *retval);
+void sys__exit(int exitcode);
+int sys_getpid(pid_t *retval);
+int sys_waitpid(pid_t pid, userptr_t status, int options, pid_t *retval);
+#if OPT_A2
+int sys_fork(struct trapframe *currenttf, pid_t *retval);
+int sys_vfork(struct trapframe *currenttf, pid_t *retval);
+int sys_execv(userptr_t progname, userptr_t args); 
+int sys_spawn(userptr_t progname, userptr_t args, pid_t *retval);
+int sys_batch(userptr_t entries, unsigned n, int32_t *retval);
+#endif /* OPT_A2 */
+#endif // UW
 #endif /* _SYSCALL_H_ */
\ No newline at end of file
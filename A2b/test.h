@@ -1,80 +1,109 @@
-/*
- * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
- *	The President and Fellows of Harvard College.
- *
- * Redistribution and use in source and binary forms, with or without
- * modification, are permitted provided that the following conditions
- * are met:
- * 1. Redistributions of source code must retain the above copyright
- *    notice, this list of conditions and the following disclaimer.
- * 2. Redistributions in binary form must reproduce the above copyright
- *    notice, this list of conditions and the following disclaimer in the
- *    documentation and/or other materials provided with the distribution.
- * 3. Neither the name of the University nor the names of its contributors
- *    may be used to endorse or promote products derived from this software
- *    without specific prior written permission.
- *
- * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
- * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
- * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
- * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
- * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
- * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
- * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
- * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
- * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
- * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
- * SUCH DAMAGE.
- */
-#ifndef _TEST_H_
-#define _TEST_H_
-#include "opt-A2.h"
-/*
- * Declarations for test code and other miscellaneous high-level
- * functions.
- */
-/* This is only actually available if OPT_SYNCHPROBS is set. */
-int whalemating(int, char **);
-#ifdef UW
-int catmouse(int, char **);
-int traffic_simulation(int, char **);
-#endif
-/*
- * Test code.
- */
-/* lib tests */
-int arraytest(int, char **);
-int bitmaptest(int, char **);
-int queuetest(int, char **);
-/* thread tests */
-int threadtest(int, char **);
-int threadtest2(int, char **);
-int threadtest3(int, char **);
-int semtest(int, char **);
-int locktest(int, char **);
-int cvtest(int, char **);
-#ifdef UW
-/* Another thread and synchronization test */
-int uwlocktest1(int, char **);
-/* Used to test uw-vmstats */
-int uwvmstatstest(int, char **);
-#endif
-/* filesystem tests */
-int fstest(int, char **);
-int readstress(int, char **);
-int writestress(int, char **);
-int writestress2(int, char **);
-int createstress(int, char **);
-int printfile(int, char **);
-/* other tests */
-int malloctest(int, char **);
-int mallocstress(int, char **);
-int nettest(int, char **);
-/* Routine for running a user-level program. */
-//int runprogram(char *progname);
-int runprogram(char* progname, char** args, unsigned long argc);
-/* Kernel menu system. */
-void menu(char *argstr);
-/* The main function, called from start.S. */
-void kmain(char *bootstring);
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef _TEST_H_
+#define _TEST_H_
+#include "opt-A2.h"
+#include "opt-A3.h"
+/*
+ * Declarations for test code and other miscellaneous high-level
+ * functions.
+ */
+/* This is only actually available if OPT_SYNCHPROBS is set. */
+int whalemating(int, char **);
+#ifdef UW
+int catmouse(int, char **);
+int traffic_simulation(int, char **);
+#endif
+/*
+ * Test code.
+ */
+/* lib tests */
+int arraytest(int, char **);
+int bitmaptest(int, char **);
+int queuetest(int, char **);
+/* thread tests */
+int threadtest(int, char **);
+int threadtest2(int, char **);
+int threadtest3(int, char **);
+int semtest(int, char **);
+int locktest(int, char **);
+int cvtest(int, char **);
+/* more synch tests and benchmarks, in synchtest2.c */
+int lockbench(int, char **);
+int handofftest(int, char **);
+int rwlocktest(int, char **);
+int rwlockbench(int, char **);
+int timedtest(int, char **);
+#ifdef UW
+/* Another thread and synchronization test */
+int uwlocktest1(int, char **);
+/* Used to test uw-vmstats */
+int uwvmstatstest(int, char **);
+#endif
+/* filesystem tests */
+int fstest(int, char **);
+int readstress(int, char **);
+int writestress(int, char **);
+int writestress2(int, char **);
+int createstress(int, char **);
+int printfile(int, char **);
+/* other tests */
+int malloctest(int, char **);
+int mallocstress(int, char **);
+int nettest(int, char **);
+/* Routine for running a user-level program. */
+//int runprogram(char *progname);
+int runprogram(char* progname, char** args, unsigned long argc);
+/* Load a program and its arguments into curproc without running it. */
+struct arg_arena;
+int loadprogram(char *progname, struct arg_arena *args,
+		vaddr_t *entrypoint, vaddr_t *stackptr);
+#if OPT_A2
+/* Per-exec argument arena, in runprogram.c. */
+struct arg_arena *arg_arena_get(void);
+void arg_arena_put(struct arg_arena *a);
+char *arg_arena_path(struct arg_arena *a);
+unsigned long arg_arena_argc(struct arg_arena *a);
+int arg_arena_copyin(struct arg_arena *a, userptr_t progname, userptr_t args);
+int arg_arena_setargs(struct arg_arena *a, const char *progname,
+		      char **args, unsigned long argc);
+/* process lifecycle tests, in proctest.c */
+int forksoak(int, char **);
+int procbench(int, char **);
+/* exec argument benchmark, in runprogram.c */
+int argbench(int, char **);
+#if OPT_A3
+int kdatatest(int, char **);
+#endif /* OPT_A3 */
+#endif /* OPT_A2 */
+/* Kernel menu system. */
+void menu(char *argstr);
+/* The main function, called from start.S. */
+void kmain(char *bootstring);
 #endif /* _TEST_H_ */
\ No newline at end of file
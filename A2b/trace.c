@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/*
+ * Tracepoint records and their formatting. See trace.h.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <spinlock.h>
+#include <trace.h>
+#define TRACE_RING_SIZE 512		/* records; power of 2 */
+struct trace_rec {
+	uint32_t tr_cycles;
+	enum tracepoint_id tr_tp;
+	uint32_t tr_args[4];
+};
+static const struct {
+	const char *name;
+	const char *fmt;
+} tracepoints[TP_COUNT] = {
+	[TP_VM_FAULT] =		{ "vm_fault",	"dumbvm: fault: type %u 0x%x\n" },
+	[TP_VM_TLBLOAD] =	{ "vm_tlbload",	"dumbvm: 0x%x -> 0x%x\n" },
+	[TP_SYSCALL] =		{ "syscall",
+				  "syscall: #%u, args %x %x %x\n" },
+	[TP_SYSCALL_EXIT] =	{ "exit",	"Syscall: _exit(%d)\n" },
+	[TP_EXEC_SEGMENT] =	{ "exec_segment",
+				  "ELF: Loading %u bytes to 0x%x\n" },
+};
+volatile bool tracepoint_on[TP_COUNT];
+static struct spinlock trace_lock = SPINLOCK_INITIALIZER;
+static struct trace_rec trace_ring[TRACE_RING_SIZE];
+static unsigned trace_head;		/* records ever written */
+static unsigned trace_tail;		/* records ever printed */
+void
+trace_record(enum tracepoint_id tp, uint32_t a, uint32_t b,
+	     uint32_t c, uint32_t d)
+{
+	struct trace_rec *rec;
+	spinlock_acquire(&trace_lock);
+	rec = &trace_ring[trace_head++ & (TRACE_RING_SIZE - 1)];
+	if (trace_head - trace_tail > TRACE_RING_SIZE) {
+		/* overwrote the oldest record */
+		trace_tail++;
+	}
+	rec->tr_cycles = trace_cycles();
+	rec->tr_tp = tp;
+	rec->tr_args[0] = a;
+	rec->tr_args[1] = b;
+	rec->tr_args[2] = c;
+	rec->tr_args[3] = d;
+	spinlock_release(&trace_lock);
+}
+int
+trace_set(const char *name, bool on)
+{
+	bool all = !strcmp(name, "all");
+	int result = ENOENT;
+	for (unsigned i = 0; i < TP_COUNT; i++) {
+		if (all || !strcmp(name, tracepoints[i].name)) {
+			tracepoint_on[i] = on;
+			result = 0;
+		}
+	}
+	return result;
+}
+void
+trace_list(void)
+{
+	for (unsigned i = 0; i < TP_COUNT; i++) {
+		kprintf("    %-16s %s\n", tracepoints[i].name,
+			tracepoint_on[i] ? "on" : "off");
+	}
+}
+void
+trace_print(void)
+{
+	struct trace_rec rec;
+	while (1) {
+		/* copy out one record at a time; kprintf may sleep */
+		spinlock_acquire(&trace_lock);
+		if (trace_tail == trace_head) {
+			spinlock_release(&trace_lock);
+			return;
+		}
+		rec = trace_ring[trace_tail++ & (TRACE_RING_SIZE - 1)];
+		spinlock_release(&trace_lock);
+		kprintf("%08x ", rec.tr_cycles);
+		kprintf(tracepoints[rec.tr_tp].fmt, rec.tr_args[0],
+			rec.tr_args[1], rec.tr_args[2], rec.tr_args[3]);
+	}
+}
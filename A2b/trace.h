@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2000, 2001, 2002, 2003, 2004, 2005, 2008, 2009
+ *	The President and Fellows of Harvard College.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef _TRACE_H_
+#define _TRACE_H_
+/*
+ * Tracepoints.
+ *
+ * A tracepoint is a named spot in the kernel that, when switched on,
+ * appends a binary record (its id, the cycle count and up to four
+ * words of arguments) to a shared trace ring. Nothing is formatted
+ * until the ring is printed, so a hit costs a spinlock and a few
+ * stores, and a tracepoint that is off costs one load and branch.
+ *
+ * Tracepoints are switched on and off by name at runtime, from the
+ * kernel menu ("tp"). To add one, add its id here and its name and
+ * printf format (which sees the four arguments as unsigned ints) to
+ * the table in trace.c.
+ */
+enum tracepoint_id {
+	TP_VM_FAULT,		/* vm_fault entry: type, address */
+	TP_VM_TLBLOAD,		/* vm_fault TLB load: address, paddr */
+	TP_SYSCALL,		/* syscall entry: number, a0-a2 */
+	TP_SYSCALL_EXIT,	/* _exit: exit code */
+	TP_EXEC_SEGMENT,	/* load_segment: bytes, vaddr */
+	TP_COUNT
+};
+/*
+ * Read the CP0 cycle counter. Used for trace record timestamps and
+ * for the per-syscall latency histograms in syscall.c.
+ */
+static inline
+uint32_t
+trace_cycles(void)
+{
+	uint32_t count;
+	__asm volatile("mfc0 %0, $9" : "=r" (count));
+	return count;
+}
+extern volatile bool tracepoint_on[TP_COUNT];
+#define TRACE(tp, a, b, c, d) \
+	do { \
+		if (tracepoint_on[tp]) { \
+			trace_record(tp, (uint32_t)(a), (uint32_t)(b), \
+				     (uint32_t)(c), (uint32_t)(d)); \
+		} \
+	} while (0)
+void trace_record(enum tracepoint_id tp, uint32_t a, uint32_t b,
+		  uint32_t c, uint32_t d);
+/* Switch a tracepoint (or "all") on or off. Returns ENOENT if unknown. */
+int trace_set(const char *name, bool on);
+/* List tracepoints and their state. */
+void trace_list(void);
+/* Format and print the trace ring, oldest record first, and empty it. */
+void trace_print(void);
+#endif /* _TRACE_H_ */